@@ -56,6 +56,10 @@
 #include "aisle_manager.h"
 #include "store_util.h"
 
+#ifdef __x86_64__
+#include <immintrin.h>  // for _pdep_u32
+#endif
+
 // the number of total bits in a section
 #define SECTION_SIZE 16
 
@@ -191,23 +195,87 @@ void toggle_space(unsigned long* aisle, int index, int space_index) {
   set_section(aisle, index, section);
 }
 
+// Every spaces bit of every section of an aisle
+#define ALL_SPACES_MASK 0x03FF03FF03FF03FFUL
+
+/* Given an aisle, return the number of items in each of its sections, each
+ * count in the low bits of that section's 16 bits. Counts the bits of all
+ * four sections at once by adding neighboring bits, then pairs, then nibbles,
+ * then bytes.
+ */
+static unsigned long section_counts(unsigned long aisle) {
+  unsigned long x = aisle & ALL_SPACES_MASK;
+
+  x = x - ((x >> 1) & 0x5555555555555555UL);  // 2-bit counts
+  x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);  // 4-bit
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FUL;  // 8-bit
+  return (x + (x >> 8)) & 0x00FF00FF00FF00FFUL;  // 16-bit, at most 10 each
+}
+
+#ifdef __x86_64__
+/* Number of items in the given spaces, with the popcnt instruction */
+__attribute__((target("popcnt")))
+static unsigned short count_items_popcnt(unsigned short spaces) {
+  return (unsigned short) __builtin_popcount(spaces);
+}
+
+/* Given spaces and a mask of n bits at the bottom, return the n lowest set
+ * bits of spaces (or all of them, if it has fewer): pdep deposits the mask's
+ * bits into the positions of spaces' set bits, lowest first.
+ */
+__attribute__((target("bmi2")))
+static unsigned short lowest_set_bits_bmi2(unsigned short spaces, unsigned int n_mask) {
+  return (unsigned short) _pdep_u32(n_mask, spaces);
+}
+#endif
+
+/* Portable version of lowest_set_bits_bmi2: clears the lowest set bit of a
+ * copy of spaces (x & (x - 1)) on each of the first n of NUM_SPACES steps,
+ * then returns the bits that were cleared. The steps past n are masked out
+ * rather than skipped, so no branch depends on the data.
+ */
+static unsigned short lowest_set_bits_portable(unsigned short spaces, unsigned int n_mask) {
+  unsigned int left = spaces;
+
+  for (int i = 0; i < NUM_SPACES; i++) {
+    unsigned int step = -((n_mask >> i) & 1); // all ones for the first n steps
+    left &= (left - 1) | ~step;
+  }
+
+  return (unsigned short) (spaces & ~left);
+}
+
+/* Given spaces and a number of items, return the lowest min(n, number of set
+ * bits) set bits of spaces. n below 0 counts as 0.
+ */
+static unsigned short lowest_set_bits(unsigned short spaces, int n) {
+  n = n < 0 ? 0 : n;
+  n = n > NUM_SPACES ? NUM_SPACES : n;
+  unsigned int n_mask = (1U << n) - 1;
+
+#ifdef __x86_64__
+  if (__builtin_cpu_supports("bmi2")) {
+    return lowest_set_bits_bmi2(spaces, n_mask);
+  }
+#endif
+  return lowest_set_bits_portable(spaces, n_mask);
+}
+
 /* Given a pointer to an aisle and a section index, return the number of items
  * in the section at the given index of the given aisle.
  *
+ * Uses the popcnt instruction if this CPU has it, and section_counts
+ * otherwise.
+ *
  * Can assume the index is a valid index (0-3 inclusive).
  */
 unsigned short num_items(unsigned long* aisle, int index) {
-  unsigned short spaces = get_spaces(aisle, index);
-  unsigned short count = 0;
-
-  for (int i = 0; i < NUM_SPACES; i++) {
-    if (spaces & 1) { // check if the least significant bit is 1
-      count++;
-    }
-    spaces >>= 1; // right shift to check the next bit
+#ifdef __x86_64__
+  if (__builtin_cpu_supports("popcnt")) {
+    return count_items_popcnt(get_spaces(aisle, index));
   }
-
-  return count;
+#endif
+  return (section_counts(*aisle) >> (index * SECTION_SIZE)) & SECTION_MASK;
 }
 
 /* Given a pointer to an aisle, a section index, and the desired number of
@@ -217,21 +285,16 @@ unsigned short num_items(unsigned long* aisle, int index) {
  * empty spaces in the section, then the section should appear full after the
  * method finishes.
  *
+ * The empty spaces are the set bits of the complement of the spaces, so the
+ * items go into the lowest n of those.
+ *
  * Can assume the index is a valid index (0-3 inclusive).
  */
 void add_items(unsigned long* aisle, int index, int n) {
   unsigned short spaces = get_spaces(aisle, index);
+  unsigned short empty = ~spaces & SPACES_MASK;
 
-  for (int i = 0; i < NUM_SPACES && n > 0; i++) {
-    unsigned short bit_mask = (unsigned short)(1 << i);
-
-    if ((spaces & bit_mask) == 0) { // if the space is empty
-        spaces |= bit_mask;         // add an item to the space
-        n--;                        // decrement the number of items to add
-    }
-  }
-
-  set_spaces(aisle, index, spaces);
+  set_spaces(aisle, index, spaces | lowest_set_bits(empty, n));
 }
 
 /* Given a pointer to an aisle, a section index, and the desired number of
@@ -246,16 +309,7 @@ void add_items(unsigned long* aisle, int index, int n) {
 void remove_items(unsigned long* aisle, int index, int n) {
   unsigned short spaces = get_spaces(aisle, index);
 
-  for (int i = 0; i < NUM_SPACES && n > 0; i++) {
-    unsigned short bit_mask = (unsigned short)(1 << i);
-
-    if (spaces & bit_mask) {  // if the space is filled
-        spaces ^= bit_mask;   // remove the item from the space
-        n--;                  // decrement the number of items to remove
-    }
-  }
-
-  set_spaces(aisle, index, spaces);
+  set_spaces(aisle, index, spaces & ~lowest_set_bits(spaces, n));
 }
 
 /* Given a pointer to an aisle, a section index, and a number of slots to
@@ -295,4 +349,80 @@ void rotate_items_right(unsigned long* aisle, int index, int n) {
   if (n > 0) { // only rotate if n > 0 to avoid unnecessary work
     rotate_items_left(aisle, index, NUM_SPACES - n); // rotating right by n is the same as rotating left by (NUM_SPACES - n)
   }
-}  
\ No newline at end of file
+}  
+
+/* ----------------------------------------------------------------------------
+ * Batch (structure-of-arrays) versions
+ * ----------------------------------------------------------------------------
+ *  These work on num_aisles aisles at once instead of one section of one
+ *  aisle, and write each field of every section into its own output array.
+ *  Entry (i * NUM_SECTIONS + index) of an output array describes section
+ *  index of aisles[i], so entries come in the same order as the sections'
+ *  addresses. The loops have no branches and no calls, which lets the
+ *  compiler vectorize them across aisles.
+ */
+
+/* Given an array of num_aisles aisles, set ids[i * NUM_SECTIONS + index] to
+ * the id of the section at the given index of aisles[i], as get_id would.
+ */
+void get_ids_batch(unsigned long* aisles, int num_aisles, unsigned short* ids) {
+  for (int i = 0; i < num_aisles; i++) {
+    unsigned long aisle = aisles[i];
+
+    for (int j = 0; j < NUM_SECTIONS; j++) {
+      ids[i * NUM_SECTIONS + j] =
+          (aisle >> (j * SECTION_SIZE + NUM_SPACES)) & (ID_MASK >> NUM_SPACES);
+    }
+  }
+}
+
+/* Given an array of num_aisles aisles, set spaces[i * NUM_SECTIONS + index]
+ * to the spaces of the section at the given index of aisles[i], as get_spaces
+ * would.
+ */
+void get_spaces_batch(unsigned long* aisles, int num_aisles,
+                      unsigned short* spaces) {
+  for (int i = 0; i < num_aisles; i++) {
+    unsigned long aisle = aisles[i];
+
+    for (int j = 0; j < NUM_SECTIONS; j++) {
+      spaces[i * NUM_SECTIONS + j] = (aisle >> (j * SECTION_SIZE)) & SPACES_MASK;
+    }
+  }
+}
+
+/* Given an array of num_aisles aisles, set counts[i * NUM_SECTIONS + index]
+ * to the number of items in the section at the given index of aisles[i], as
+ * num_items would.
+ */
+void num_items_batch(unsigned long* aisles, int num_aisles,
+                     unsigned short* counts) {
+  for (int i = 0; i < num_aisles; i++) {
+    unsigned long all_counts = section_counts(aisles[i]);
+
+    for (int j = 0; j < NUM_SECTIONS; j++) {
+      counts[i * NUM_SECTIONS + j] = (all_counts >> (j * SECTION_SIZE)) & SECTION_MASK;
+    }
+  }
+}
+
+/* Given an array of num_aisles aisles, fill in the id, spaces and number of
+ * items of every section in one pass over the aisles, laid out as in
+ * get_ids_batch, get_spaces_batch and num_items_batch.
+ */
+void scan_aisles_batch(unsigned long* aisles, int num_aisles,
+                       unsigned short* ids, unsigned short* spaces,
+                       unsigned short* counts) {
+  for (int i = 0; i < num_aisles; i++) {
+    unsigned long aisle = aisles[i];
+    unsigned long all_counts = section_counts(aisle);
+
+    for (int j = 0; j < NUM_SECTIONS; j++) {
+      unsigned long section = aisle >> (j * SECTION_SIZE);
+
+      ids[i * NUM_SECTIONS + j] = (section >> NUM_SPACES) & (ID_MASK >> NUM_SPACES);
+      spaces[i * NUM_SECTIONS + j] = section & SPACES_MASK;
+      counts[i * NUM_SECTIONS + j] = (all_counts >> (j * SECTION_SIZE)) & SECTION_MASK;
+    }
+  }
+}
@@ -17,4 +17,15 @@ void toggle_space(unsigned long* aisle, int index, int space_index);
 void rotate_items_left(unsigned long* aisle, int index, int n);
 void rotate_items_right(unsigned long* aisle, int index, int n);
 
+// Batch versions over num_aisles aisles. Each output array gets
+// NUM_SECTIONS (4) entries per aisle, in section address order.
+void get_ids_batch(unsigned long* aisles, int num_aisles, unsigned short* ids);
+void get_spaces_batch(unsigned long* aisles, int num_aisles,
+                      unsigned short* spaces);
+void num_items_batch(unsigned long* aisles, int num_aisles,
+                     unsigned short* counts);
+void scan_aisles_batch(unsigned long* aisles, int num_aisles,
+                       unsigned short* ids, unsigned short* spaces,
+                       unsigned short* counts);
+
 #endif // _AISLE_MANAGER_H
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "test_util.h"
 #include "aisle_manager.h"
@@ -18,7 +19,7 @@
 static char* test_fname = NULL;
 static bool grade_output = false;
 
-#define NUM_AISLE_TESTS 12
+#define NUM_AISLE_TESTS 13
 
 int get_test_helper(get_funct get_function, unsigned long* aisle, int index, unsigned short expected_val) {
   unsigned short actual_val = get_function(aisle, index);
@@ -410,6 +411,71 @@ static int toggle_space_tests() {
   return score;
 }
 
+// Largest number of aisles the batch tests pass at once
+#define MAX_BATCH_AISLES 67
+
+int batch_test_helper(unsigned long* aisles, int num_aisles) {
+  unsigned short ids[MAX_BATCH_AISLES * 4], spaces[MAX_BATCH_AISLES * 4], counts[MAX_BATCH_AISLES * 4];
+  unsigned short scan_ids[MAX_BATCH_AISLES * 4], scan_spaces[MAX_BATCH_AISLES * 4], scan_counts[MAX_BATCH_AISLES * 4];
+
+  get_ids_batch(aisles, num_aisles, ids);
+  get_spaces_batch(aisles, num_aisles, spaces);
+  num_items_batch(aisles, num_aisles, counts);
+  scan_aisles_batch(aisles, num_aisles, scan_ids, scan_spaces, scan_counts);
+
+  for (int i = 0; i < num_aisles; i++) {
+    for (int index = 0; index < 4; index++) {
+      int k = i * 4 + index;
+      unsigned short expected_id = get_id_sol(&aisles[i], index);
+      unsigned short expected_spaces = get_spaces_sol(&aisles[i], index);
+      unsigned short expected_count = num_items_sol(&aisles[i], index);
+
+      if (ids[k] != expected_id || spaces[k] != expected_spaces || counts[k] != expected_count ||
+          scan_ids[k] != expected_id || scan_spaces[k] != expected_spaces || scan_counts[k] != expected_count) {
+        printf("\t\terror: num_aisles=%d, aisles[%d]=0x%016lx, index=%d\n", num_aisles, i, aisles[i], index);
+        printf("\t\t    expected id=0x%02hx spaces=0x%03hx items=%hu -- batch id=0x%02hx spaces=0x%03hx items=%hu, scan id=0x%02hx spaces=0x%03hx items=%hu\n",
+               expected_id, expected_spaces, expected_count, ids[k], spaces[k], counts[k],
+               scan_ids[k], scan_spaces[k], scan_counts[k]);
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+int batch_random_tests() {
+  unsigned long aisles[MAX_BATCH_AISLES];
+
+  if (!grade_output) printf("\tTesting a variety of cases (only shows first failure)...\n");
+
+  for (int i = 0; i < 500; i++) {
+    int num_aisles = rand() % (MAX_BATCH_AISLES + 1);
+
+    for (int j = 0; j < num_aisles; j++) {
+      aisles[j] = rand();
+      aisles[j] = (aisles[j] << 32) | rand();
+    }
+    if (batch_test_helper(aisles, num_aisles) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int batch_tests() {
+  unsigned long aisles[] = {0xF000BA987FFF3210, 0xFEDCBA9876543210, 0x0000000000000000, 0xFFFFFFFFFFFFFFFF};
+  int errors = 0;
+
+  if (!grade_output) printf("\tTesting specific cases...\n");
+  errors += batch_test_helper(aisles, 1);
+  errors += batch_test_helper(aisles, 4);
+
+  errors += batch_random_tests();
+
+  return errors == 0;
+}
+
 static test_info aisle_tests[] = {
   {"get_section", get_section_tests, 0, 1},
   {"get_spaces", get_spaces_tests, 0, 1},
@@ -423,6 +489,7 @@ static test_info aisle_tests[] = {
   {"remove_items", remove_items_tests, 0, 1},
   {"rotate_items_left", rotate_items_left_tests, 0, 3},
   {"rotate_items_right", rotate_items_right_tests, 0, 1},
+  {"batch", batch_tests, 0, 1},
 };
 
 // Run all tests
@@ -484,21 +551,137 @@ void run_tests() {
 	}
 }
 
+// Benchmark (-b) sizes: calls per function are BENCH_AISLES * BENCH_ROUNDS
+#define BENCH_AISLES 4096
+#define BENCH_ROUNDS 2000
+
+// The bit-by-bit loops num_items, add_items and remove_items used to be,
+// for the benchmark to compare against
+static unsigned short num_items_loop(unsigned long* aisle, int index) {
+  unsigned short spaces = get_spaces(aisle, index);
+  unsigned short count = 0;
+
+  for (int i = 0; i < 10; i++) {
+    if (spaces & 1) count++;
+    spaces >>= 1;
+  }
+  return count;
+}
+
+static void add_items_loop(unsigned long* aisle, int index, int n) {
+  unsigned short spaces = get_spaces(aisle, index);
+
+  for (int i = 0; i < 10 && n > 0; i++) {
+    unsigned short bit_mask = (unsigned short)(1 << i);
+    if ((spaces & bit_mask) == 0) {
+      spaces |= bit_mask;
+      n--;
+    }
+  }
+  set_spaces(aisle, index, spaces);
+}
+
+static void remove_items_loop(unsigned long* aisle, int index, int n) {
+  unsigned short spaces = get_spaces(aisle, index);
+
+  for (int i = 0; i < 10 && n > 0; i++) {
+    unsigned short bit_mask = (unsigned short)(1 << i);
+    if (spaces & bit_mask) {
+      spaces ^= bit_mask;
+      n--;
+    }
+  }
+  set_spaces(aisle, index, spaces);
+}
+
+static unsigned long bench_aisles[BENCH_AISLES];
+static int bench_indexes[BENCH_AISLES];
+static int bench_ns[BENCH_AISLES];
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Time get_function over the benchmark aisles; *sum gets the sum of its results
+static double time_get(get_funct get_function, unsigned long* sum) {
+  double start = now_ns();
+
+  *sum = 0;
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    for (int i = 0; i < BENCH_AISLES; i++) {
+      *sum += get_function(&bench_aisles[i], bench_indexes[i]);
+    }
+  }
+  return (now_ns() - start) / ((double) BENCH_AISLES * BENCH_ROUNDS);
+}
+
+// Time items_function over a copy of the benchmark aisles, left in aisles
+static double time_items(items_funct items_function, unsigned long* aisles) {
+  memcpy(aisles, bench_aisles, sizeof(bench_aisles));
+  double start = now_ns();
+
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    for (int i = 0; i < BENCH_AISLES; i++) {
+      items_function(&aisles[i], bench_indexes[i], bench_ns[i] + r % 3);
+    }
+  }
+  return (now_ns() - start) / ((double) BENCH_AISLES * BENCH_ROUNDS);
+}
+
+static void print_bench(char* fname, double loop_ns, double ns, bool same) {
+  printf("%-14s loop %6.2f ns/call   now %6.2f ns/call   speedup %5.2fx%s\n",
+         fname, loop_ns, ns, loop_ns / ns, same ? "" : "   RESULTS DIFFER");
+}
+
+// Compare num_items, add_items and remove_items with the loops they replaced,
+// on random aisles, indexes and counts so that branches are unpredictable
+static void run_benchmark() {
+  static unsigned long loop_aisles[BENCH_AISLES], aisles[BENCH_AISLES];
+  unsigned long loop_sum, sum;
+  double loop_ns, ns;
+
+  for (int i = 0; i < BENCH_AISLES; i++) {
+    bench_aisles[i] = rand();
+    bench_aisles[i] = (bench_aisles[i] << 32) | rand();
+    bench_indexes[i] = rand() % 4;
+    bench_ns[i] = rand() % 11;
+  }
+  printf("Timing %d calls of each function...\n", BENCH_AISLES * BENCH_ROUNDS);
+
+  loop_ns = time_get(num_items_loop, &loop_sum);
+  ns = time_get(num_items, &sum);
+  print_bench("num_items", loop_ns, ns, loop_sum == sum);
+
+  loop_ns = time_items(add_items_loop, loop_aisles);
+  ns = time_items(add_items, aisles);
+  print_bench("add_items", loop_ns, ns, memcmp(loop_aisles, aisles, sizeof(aisles)) == 0);
+
+  loop_ns = time_items(remove_items_loop, loop_aisles);
+  ns = time_items(remove_items, aisles);
+  print_bench("remove_items", loop_ns, ns, memcmp(loop_aisles, aisles, sizeof(aisles)) == 0);
+}
+
 // Display usage info
 static void usage() {
-  printf("Usage: aisle-test [-f <name>]\n");
+  printf("Usage: aisle-test [-f <name>] [-b]\n");
   printf("  -f <name> Test only the named function\n");
+  printf("  -b        Benchmark num_items, add_items and remove_items instead\n");
 }
 
-// Only one command line flag (-f test_name)
+// Only one command line flag (-f test_name, -g or -b)
 int main(int argc, char* argv[]) {
   int c;
   srand(1);
-  if ((c = getopt(argc, argv, "gf:")) != -1) {
+  if ((c = getopt(argc, argv, "gf:b")) != -1) {
     if (c == 'f') {
       test_fname = strdup(optarg);
     } else if (c == 'g') {
 			grade_output = true;
+    } else if (c == 'b') {
+      run_benchmark();
+      return 0;
     } else {
       usage();
       exit(1);
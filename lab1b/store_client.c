@@ -31,6 +31,12 @@
 // Initial value for max_items in section_with_most_items()
 #define INITIAL_MAX_ITEMS -1
 
+// The number of bits in a section used for the item id
+#define ID_SIZE 6
+
+// Mask for extracting the spaces bits from a section
+#define SPACES_MASK 0x03FF
+
 // Global array of aisles in this store. Each unsigned long in the array
 // represents one aisle.
 unsigned long aisles[NUM_AISLES];
@@ -125,14 +131,13 @@ int fulfill_order(unsigned short id, int num) {
   return total_removed;
 }
 
-/* Return a pointer to the first section in the aisles with the given item id
- * that has no items in it or NULL if no such section exists. Only consider
- * items stored in sections in the aisles (i.e., ignore anything in the
- * stockroom). Break ties by returning the section with the lowest address.
+/* Return a pointer to the first section with the given item id and no items
+ * in aisles first_aisle and up, or NULL if there is none. Plain version of
+ * the search, one section at a time.
  */
-unsigned short* empty_section_with_id(unsigned short id) {
+static unsigned short* empty_section_with_id_scalar(unsigned short id, int first_aisle) {
 
-  for (int i = 0; i < NUM_AISLES; i++) {
+  for (int i = first_aisle; i < NUM_AISLES; i++) {
     for (int j = 0; j < SECTIONS_PER_AISLE; j++) {
       unsigned short item_id = get_id(&aisles[i], j);
       
@@ -150,26 +155,136 @@ unsigned short* empty_section_with_id(unsigned short id) {
   return NULL; // no such section exists
 }
 
-/* Return a pointer to the section with the most items in the store. Only
- * consider items stored in sections in the aisles (i.e., ignore anything in
- * the stockroom). Break ties by returning the section with the lowest address.
+/* Find the section with the most items in aisles first_aisle and up. Only
+ * replaces *result_section (and *max_items) with a section that has strictly
+ * more items, so the lowest address wins ties, including ties with the
+ * section passed in. Plain version of the search, one section at a time.
  */
-unsigned short* section_with_most_items() {
+static void section_with_most_items_scalar(int first_aisle, int* max_items,
+                                           unsigned short** result_section) {
 
-  int max_items = INITIAL_MAX_ITEMS; //ensure first section will be larger
-  unsigned short* result_section = NULL;
-
-  for (int i = 0; i < NUM_AISLES; i++) {
+  for (int i = first_aisle; i < NUM_AISLES; i++) {
     for (int j = 0; j < SECTIONS_PER_AISLE; j++) {
       unsigned short items_in_section = num_items(&aisles[i], j);
 
       // update max if needed
-      if (items_in_section > max_items) { //strictly greater to ensure lowest address in tie
-        max_items = items_in_section;
-        result_section = ((unsigned short*)&aisles[i]) + j;
+      if (items_in_section > *max_items) { //strictly greater to ensure lowest address in tie
+        *max_items = items_in_section;
+        *result_section = ((unsigned short*)&aisles[i]) + j;
+      }
+    }
+  }
+}
+
+#ifdef __x86_64__
+/* AVX2 versions: each 256-bit vector holds AISLES_PER_VECTOR aisles, i.e.
+ * 16 sections, one per 16-bit lane, with lanes in address order. The aisles
+ * left over after the last full vector go through the scalar versions.
+ */
+#include <immintrin.h>
+
+// Number of aisles in one AVX2 vector
+#define AISLES_PER_VECTOR 4
+
+/* A section is empty and holds the given id exactly when all of its bits
+ * equal the id shifted past the spaces, so each vector takes one compare.
+ */
+__attribute__((target("avx2")))
+static unsigned short* empty_section_with_id_avx2(unsigned short id) {
+  int i;
+
+  if (id >> ID_SIZE) { // no section can have an id this large
+    return NULL;
+  }
+
+  __m256i wanted = _mm256_set1_epi16((short) (id << NUM_SPACES));
+  for (i = 0; i + AISLES_PER_VECTOR <= NUM_AISLES; i += AISLES_PER_VECTOR) {
+    __m256i sections = _mm256_loadu_si256((__m256i*) &aisles[i]);
+    unsigned int matches = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi16(sections, wanted));
+
+    if (matches != 0) { // lowest set bit is the lowest matching address
+      return ((unsigned short*) &aisles[i]) + __builtin_ctz(matches) / 2;
+    }
+  }
+
+  return empty_section_with_id_scalar(id, i);
+}
+
+/* Counts the items in all 16 sections at once: the spaces are masked out,
+ * each nibble is counted with a table lookup, and the two byte counts of a
+ * section are added. Each half of the vector is then searched for its
+ * section with the most items with _mm_minpos_epu16, which finds the lowest
+ * lane holding the minimum; counting empty spaces instead of items turns
+ * the maximum into a minimum.
+ */
+__attribute__((target("avx2")))
+static unsigned short* section_with_most_items_avx2() {
+  const __m256i nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+  const __m256i spaces_mask = _mm256_set1_epi16(SPACES_MASK);
+  const __m256i ones = _mm256_set1_epi8(1);
+  const __m256i all_spaces = _mm256_set1_epi16(NUM_SPACES);
+  int max_items = INITIAL_MAX_ITEMS;
+  unsigned short* result_section = NULL;
+  int i;
+
+  for (i = 0; i + AISLES_PER_VECTOR <= NUM_AISLES; i += AISLES_PER_VECTOR) {
+    __m256i spaces = _mm256_and_si256(_mm256_loadu_si256((__m256i*) &aisles[i]), spaces_mask);
+    __m256i low = _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(spaces, low_nibbles));
+    __m256i high = _mm256_shuffle_epi8(nibble_counts,
+                                       _mm256_and_si256(_mm256_srli_epi16(spaces, 4), low_nibbles));
+    __m256i counts = _mm256_maddubs_epi16(_mm256_add_epi8(low, high), ones);
+    __m256i empty = _mm256_sub_epi16(all_spaces, counts);
+
+    for (int half = 0; half < 2; half++) { // lower addresses first
+      __m128i best = _mm_minpos_epu16(half ? _mm256_extracti128_si256(empty, 1)
+                                           : _mm256_castsi256_si128(empty));
+      int items = NUM_SPACES - _mm_extract_epi16(best, 0);
+
+      if (items > max_items) { //strictly greater to ensure lowest address in tie
+        max_items = items;
+        result_section = ((unsigned short*) &aisles[i]) + half * 8 + _mm_extract_epi16(best, 1);
       }
     }
   }
 
+  section_with_most_items_scalar(i, &max_items, &result_section);
   return result_section;
-}
\ No newline at end of file
+}
+#endif // __x86_64__
+
+/* Return a pointer to the first section in the aisles with the given item id
+ * that has no items in it or NULL if no such section exists. Only consider
+ * items stored in sections in the aisles (i.e., ignore anything in the
+ * stockroom). Break ties by returning the section with the lowest address.
+ *
+ * Uses the AVX2 version if this CPU has AVX2.
+ */
+unsigned short* empty_section_with_id(unsigned short id) {
+#ifdef __x86_64__
+  if (__builtin_cpu_supports("avx2")) {
+    return empty_section_with_id_avx2(id);
+  }
+#endif
+  return empty_section_with_id_scalar(id, 0);
+}
+
+/* Return a pointer to the section with the most items in the store. Only
+ * consider items stored in sections in the aisles (i.e., ignore anything in
+ * the stockroom). Break ties by returning the section with the lowest address.
+ *
+ * Uses the AVX2 version if this CPU has AVX2.
+ */
+unsigned short* section_with_most_items() {
+#ifdef __x86_64__
+  if (__builtin_cpu_supports("avx2")) {
+    return section_with_most_items_avx2();
+  }
+#endif
+  int max_items = INITIAL_MAX_ITEMS; //ensure first section will be larger
+  unsigned short* result_section = NULL;
+
+  section_with_most_items_scalar(0, &max_items, &result_section);
+  return result_section;
+}
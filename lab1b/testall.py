@@ -15,7 +15,7 @@ if compilation_err:
     print(compilation_err)
 else:
     aisle = subprocess.run(["./aisle_test"], capture_output=True, text=True)
-    aisle_corr = re.search("Total Score: 22/22", aisle.stdout)
+    aisle_corr = re.search("Total Score: 23/23", aisle.stdout)
     if not aisle_corr: 
         print("----- AISLE TEST -----")
         print(aisle.stdout)
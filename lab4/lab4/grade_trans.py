@@ -67,6 +67,16 @@ def main():
     # result63 = re.findall(r'(\d+)', stdout_data)
 
     # Compute the scores for each step
+    #
+    # The thresholds below date from when test-trans replayed a valgrind
+    # trace through csim-ref. That trace kept every access below 4 GiB
+    # between the markers: the stores to MARKER_START and MARKER_END and the
+    # loads of tracegen's globals around the call, as well as A and B.
+    # test-trans now counts only the accesses to A and B (the -L path too),
+    # so a transpose scores a few misses fewer than it did: the row-wise
+    # scan is 868 hits and 1180 misses at 32x32, where csim-ref said 870
+    # and 1183. The thresholds are left as they were; the difference is
+    # far below the width of either range.
     trans_cscore = int(result32[0]) * int(result64[0]);
     #trans_cscore = int(result32[0]) * int(result64[0]) * int(result63[0]);
     miss32 = int(result32[1])
@@ -0,0 +1,258 @@
+/*
+ * autotune.c - Searches the tiled transpose parameters in tiled.h for the
+ *     variant with the fewest misses on a given matrix shape and cache, by
+ *     running every candidate in-process against the cache model (the same
+ *     way test-trans scores the registered functions).
+ *
+ * The best variant is written to trans-tuned.c as a registered transpose
+ * function. When that file exists, the Makefile links it into test-trans
+ * and tracegen, which register it after trans.c's functions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "cachesim.h"
+#include "memtrace.h"
+#include "tiled.h"
+
+/* Largest dimension worth an exhaustive search */
+#define MAXN 256
+
+/* Most candidates we will ever generate */
+#define MAX_CANDIDATES 8192
+
+typedef struct candidate {
+    tile_params_t params;
+    unsigned int misses;
+    int order;              /* generation order, for breaking ties */
+} candidate_t;
+
+/* A, B and the reference transpose, laid out as test-trans lays them out
+   (see allocOperands()), so a candidate scores the same misses in both */
+static int* A_buf;
+static int* B_buf;
+static int* C_buf;
+static candidate_t candidates[MAX_CANDIDATES];
+
+/*
+ * is_tile_size - Tile edges worth trying: powers of two and three or five
+ *     times a power of two, which covers the common block and set counts
+ */
+static int is_tile_size(int n) {
+    while (n % 2 == 0)
+        n /= 2;
+    return n == 1 || n == 3 || n == 5;
+}
+
+/*
+ * generate - Fill candidates with every parameter combination for an
+ *     M x N matrix, simplest first. Returns the number generated.
+ */
+static int generate(int M, int N) {
+    int rows, cols, col_major, diag, buffer;
+    int n = 0;
+
+    for (buffer = 0; buffer <= 1; buffer++)
+        for (diag = 0; diag <= 1; diag++)
+            for (col_major = 0; col_major <= 1; col_major++)
+                for (rows = 1; rows <= M; rows++)
+                    for (cols = 1; cols <= N; cols++) {
+                        if (!is_tile_size(rows) || !is_tile_size(cols))
+                            continue;
+                        if (buffer && cols > TILE_MAX_BUFFERED)
+                            continue;
+                        if (n == MAX_CANDIDATES)
+                            return n;
+                        candidates[n].params.tile_rows = rows;
+                        candidates[n].params.tile_cols = cols;
+                        candidates[n].params.col_major = col_major;
+                        candidates[n].params.defer_diagonal = diag;
+                        candidates[n].params.buffer_rows = buffer;
+                        candidates[n].order = n;
+                        n++;
+                    }
+    return n;
+}
+
+/*
+ * evaluate - Run one candidate against sim and count its misses. Returns 0
+ *     if it does not compute the transpose.
+ */
+static int evaluate(candidate_t* cand, int M, int N, cache_sim_t* sim) {
+    int (*A)[N] = (int (*)[N]) A_buf;
+    int (*B)[M] = (int (*)[M]) B_buf;
+    int (*C)[M] = (int (*)[M]) C_buf;
+    unsigned int hits, evictions;
+
+    memset(B_buf, 0, sizeof(int) * M * N);
+    cachesim_reset(sim);
+    memtrace_begin(sim);
+    memtrace_add_range(A_buf, sizeof(int) * M * N);
+    memtrace_add_range(B_buf, sizeof(int) * M * N);
+    tiled_trans(&cand->params, M, N, A, B);
+    memtrace_end();
+    cachesim_results(sim, &hits, &cand->misses, &evictions);
+
+    return memcmp(B, C, sizeof(int) * M * N) == 0;
+}
+
+/*
+ * compare_candidates - qsort order: fewest misses, then generation order
+ *     (simpler variants first)
+ */
+static int compare_candidates(const void* a, const void* b) {
+    const candidate_t* x = a;
+    const candidate_t* y = b;
+    if (x->misses != y->misses)
+        return x->misses < y->misses ? -1 : 1;
+    return x->order - y->order;
+}
+
+/*
+ * emit - Write the best candidate to path as a registered transpose
+ */
+static int emit(const char* path, const candidate_t* best, int num_candidates,
+                int M, int N, unsigned int s, unsigned int E, unsigned int b) {
+    char desc[128];
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+        return 0;
+
+    tile_params_describe(&best->params, desc, sizeof(desc));
+    fprintf(fp, "/*\n");
+    fprintf(fp, " * %s - Generated by ./autotune -M %d -N %d -s %u -E %u -b %u.\n",
+            path, M, N, s, E, b);
+    fprintf(fp, " *     Best of %d tiled variants with %u misses. Rerun autotune\n",
+            num_candidates, best->misses);
+    fprintf(fp, " *     to retune, or delete this file to stop registering it.\n");
+    fprintf(fp, " */\n");
+    fprintf(fp, "#include \"support/cachelab.h\"\n");
+    fprintf(fp, "#include \"support/tiled.h\"\n\n");
+    fprintf(fp, "char transpose_tuned_desc[] = \"Tuned %dx%d (s=%u, E=%u, b=%u): %s\";\n",
+            M, N, s, E, b, desc);
+    fprintf(fp, "void transpose_tuned(int M, int N, int A[M][N], int B[N][M]) {\n");
+    fprintf(fp, "    static const tile_params_t params = { %d, %d, %d, %d, %d };\n",
+            best->params.tile_rows, best->params.tile_cols, best->params.col_major,
+            best->params.defer_diagonal, best->params.buffer_rows);
+    fprintf(fp, "    tiled_trans(&params, M, N, A, B);\n");
+    fprintf(fp, "}\n\n");
+    fprintf(fp, "void registerTunedFunctions() {\n");
+    fprintf(fp, "    registerTransFunction(transpose_tuned, transpose_tuned_desc);\n");
+    fprintf(fp, "}\n");
+    fclose(fp);
+    return 1;
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[]) {
+    printf("Usage: %s [-h] -M <rows> -N <cols> [-s <num> -E <num> -b <num>] [-n <num>] [-o <file>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
+    printf("  -N <cols>   Number of matrix columns (max %d)\n", MAXN);
+    printf("  -s <num>    Number of set index bits (default 5).\n");
+    printf("  -E <num>    Number of lines per set (default 1).\n");
+    printf("  -b <num>    Number of block offset bits (default 5).\n");
+    printf("  -n <num>    Number of best variants to list (default 10).\n");
+    printf("  -o <file>   Where to write the best variant (default trans-tuned.c).\n");
+    printf("Example: %s -M 64 -N 64 -s 5 -E 1 -b 5\n", argv[0]);
+}
+
+int main(int argc, char* argv[]) {
+    int M = 0, N = 0, top = 10;
+    unsigned int s = 5, E = 1, b = 5;
+    char* out_file = "trans-tuned.c";
+    char desc[128];
+    cache_sim_t* sim;
+    size_t len[3];
+    int* bufs[3];
+    int num_candidates, num_valid = 0;
+    int i;
+    char c;
+
+    while ((c = getopt(argc, argv, "hM:N:s:E:b:n:o:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv);
+            exit(0);
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 's':
+            s = atoi(optarg);
+            break;
+        case 'E':
+            E = atoi(optarg);
+            break;
+        case 'b':
+            b = atoi(optarg);
+            break;
+        case 'n':
+            top = atoi(optarg);
+            break;
+        case 'o':
+            out_file = optarg;
+            break;
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (M <= 0 || N <= 0 || M > MAXN || N > MAXN) {
+        printf("Error: M and N must be between 1 and %d\n", MAXN);
+        usage(argv);
+        exit(1);
+    }
+
+    sim = cachesim_create(s, E, b);
+    if (sim == NULL) {
+        printf("Error: Invalid cache geometry\n");
+        exit(1);
+    }
+
+    len[0] = len[1] = len[2] = (size_t) M * N;
+    if (allocOperands(3, len, bufs) == NULL) {
+        printf("Error: Unable to allocate %dx%d matrices\n", M, N);
+        exit(1);
+    }
+    A_buf = bufs[0];
+    B_buf = bufs[1];
+    C_buf = bufs[2];
+    initMatrix(M, N, (int (*)[N]) A_buf, (int (*)[M]) B_buf);
+    correctTrans(M, N, (int (*)[N]) A_buf, (int (*)[M]) C_buf);
+
+    /* Score every candidate, dropping any that get the transpose wrong */
+    num_candidates = generate(M, N);
+    for (i = 0; i < num_candidates; i++) {
+        if (evaluate(&candidates[i], M, N, sim))
+            candidates[num_valid++] = candidates[i];
+    }
+    cachesim_free(sim);
+    if (num_valid == 0) {
+        printf("Error: No variant computed the transpose correctly\n");
+        exit(1);
+    }
+    qsort(candidates, num_valid, sizeof(candidate_t), compare_candidates);
+
+    printf("Best of %d variants for %dx%d (s=%u, E=%u, b=%u):\n",
+           num_valid, M, N, s, E, b);
+    for (i = 0; i < top && i < num_valid; i++) {
+        tile_params_describe(&candidates[i].params, desc, sizeof(desc));
+        printf("%4d. misses:%-8u %s\n", i + 1, candidates[i].misses, desc);
+    }
+
+    if (!emit(out_file, &candidates[0], num_valid, M, N, s, E, b)) {
+        printf("Error: Could not write %s\n", out_file);
+        exit(1);
+    }
+    printf("Wrote %s\n", out_file);
+    return 0;
+}
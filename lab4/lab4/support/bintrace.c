@@ -0,0 +1,171 @@
+/*
+ * bintrace.c - Reader and writer for the binary trace format in bintrace.h.
+ *
+ * After BINTRACE_MAGIC, the file header holds one byte of BINTRACE_* flags.
+ *
+ * Record header byte layout:
+ *     bits 0-1  operation: 0 = L, 1 = S, 2 = M, 3 = I
+ *     bits 2-3  log2 of the access size, when the size is 1, 2, 4 or 8
+ *     bit  4    set if the size is anything else; it then follows the
+ *               address delta as a varint
+ *     bit  5    set if the address delta equals the previous delta of the
+ *               same operation, in which case the delta is omitted
+ * Varints are little-endian base 128 (7 bits per byte, high bit set on all
+ * but the last byte). Address deltas are taken from the previous address of
+ * the same operation and zigzag encoded so that small negative strides stay
+ * small.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bintrace.h"
+
+#define OP_MASK 0x3
+#define LEN_SHIFT 2
+#define LEN_ESCAPE 0x10
+#define REPEAT_DELTA 0x20
+
+static const char op_chars[] = { 'L', 'S', 'M', 'I' };
+
+/*
+ * put_varint - Write v in base 128
+ */
+static void put_varint(FILE* fp, unsigned long long v) {
+    while (v >= 0x80) {
+        putc((int) (v & 0x7f) | 0x80, fp);
+        v >>= 7;
+    }
+    putc((int) v, fp);
+}
+
+/*
+ * get_varint - Read a base 128 value into *v. Returns 0 at end of file.
+ */
+static int get_varint(FILE* fp, unsigned long long* v) {
+    unsigned long long result = 0;
+    int shift = 0;
+    int c;
+
+    do {
+        if ((c = getc(fp)) == EOF || shift > 63)
+            return 0;
+        result |= (unsigned long long) (c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    *v = result;
+    return 1;
+}
+
+/*
+ * new_trace - Allocate a trace on fp with every operation starting at 0
+ */
+static bintrace_t* new_trace(FILE* fp, int flags) {
+    bintrace_t* trace = calloc(1, sizeof(bintrace_t));
+    if (trace == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    trace->fp = fp;
+    trace->flags = flags;
+    return trace;
+}
+
+/*
+ * bintrace_open_write - Create path and write the header
+ */
+bintrace_t* bintrace_open_write(const char* path, int flags) {
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+        return NULL;
+    fwrite(BINTRACE_MAGIC, 1, BINTRACE_MAGIC_LEN, fp);
+    putc(flags, fp);
+    return new_trace(fp, flags);
+}
+
+/*
+ * bintrace_write - Append one record
+ */
+void bintrace_write(bintrace_t* trace, char op, unsigned long long addr,
+                    unsigned int len) {
+    int kind = (op == 'S') ? 1 : (op == 'M') ? 2 : (op == 'I') ? 3 : 0;
+    unsigned long long delta = addr - trace->prev_addr[kind];
+    unsigned long long zigzag = (delta << 1) ^ -(delta >> 63);
+    int header = kind;
+
+    switch (len) {
+    case 1: break;
+    case 2: header |= 1 << LEN_SHIFT; break;
+    case 4: header |= 2 << LEN_SHIFT; break;
+    case 8: header |= 3 << LEN_SHIFT; break;
+    default: header |= LEN_ESCAPE; break;
+    }
+
+    if (delta == trace->prev_delta[kind])
+        header |= REPEAT_DELTA;
+
+    putc(header, trace->fp);
+    if (!(header & REPEAT_DELTA))
+        put_varint(trace->fp, zigzag);
+    if (header & LEN_ESCAPE)
+        put_varint(trace->fp, len);
+    trace->prev_addr[kind] = addr;
+    trace->prev_delta[kind] = delta;
+}
+
+/*
+ * bintrace_open_read - Open path for streaming reads, checking the header
+ */
+bintrace_t* bintrace_open_read(const char* path) {
+    char magic[BINTRACE_MAGIC_LEN];
+    int flags;
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+    if (fread(magic, 1, BINTRACE_MAGIC_LEN, fp) != BINTRACE_MAGIC_LEN
+        || memcmp(magic, BINTRACE_MAGIC, BINTRACE_MAGIC_LEN) != 0
+        || (flags = getc(fp)) == EOF) {
+        fclose(fp);
+        return NULL;
+    }
+    return new_trace(fp, flags);
+}
+
+/*
+ * bintrace_read - Decode the next record
+ */
+int bintrace_read(bintrace_t* trace, char* op, unsigned long long* addr,
+                  unsigned int* len) {
+    unsigned long long zigzag, escaped_len;
+    int header = getc(trace->fp);
+    int kind = header & OP_MASK;
+
+    if (header == EOF)
+        return 0;
+    if (!(header & REPEAT_DELTA)) {
+        if (!get_varint(trace->fp, &zigzag))
+            return 0;
+        trace->prev_delta[kind] = (zigzag >> 1) ^ -(zigzag & 1);
+    }
+    trace->prev_addr[kind] += trace->prev_delta[kind];
+
+    if (header & LEN_ESCAPE) {
+        if (!get_varint(trace->fp, &escaped_len))
+            return 0;
+        *len = (unsigned int) escaped_len;
+    } else {
+        *len = 1U << ((header >> LEN_SHIFT) & 0x3);
+    }
+    *op = op_chars[kind];
+    *addr = trace->prev_addr[kind];
+    return 1;
+}
+
+/*
+ * bintrace_close - Flush and close the trace
+ */
+void bintrace_close(bintrace_t* trace) {
+    if (trace == NULL)
+        return;
+    fclose(trace->fp);
+    free(trace);
+}
@@ -0,0 +1,57 @@
+/*
+ * bintrace.h - A compact binary memory trace format. Each access is one
+ *     header byte (operation and size), followed by the varint difference
+ *     from the previous address of the same operation unless it repeats
+ *     that operation's last stride. The loads of A and stores of B in a
+ *     transpose therefore take 1-3 bytes each instead of a ~20-byte lackey
+ *     line. Files start with BINTRACE_MAGIC and a byte of BINTRACE_* flags.
+ *
+ * 'I' records give the address of the instruction making the accesses that
+ * follow them, like lackey's "I" lines, for attributing misses to code.
+ */
+
+#ifndef BINTRACE_H
+#define BINTRACE_H
+
+#include <stdio.h>
+
+#define BINTRACE_MAGIC "CLTB\002"
+#define BINTRACE_MAGIC_LEN 5
+
+/* Flags in the header. BINTRACE_FIRST_BYTE marks a trace converted from
+   lackey, whose accesses csim-ref takes to touch only the block holding
+   their first byte; otherwise an access touches every block it spans. */
+#define BINTRACE_FIRST_BYTE 0x1
+
+typedef struct bintrace {
+    FILE* fp;
+    unsigned long long prev_addr[4];    /* last address of each of L, S, M, I */
+    unsigned long long prev_delta[4];   /* last stride of each of L, S, M, I */
+    int flags;                          /* BINTRACE_* */
+} bintrace_t;
+
+/*
+ * Create path and write the header with the given BINTRACE_* flags. Returns
+ * NULL if it cannot be opened.
+ */
+bintrace_t* bintrace_open_write(const char* path, int flags);
+
+/* Append one record; op is 'L', 'S', 'M' or 'I' as in lackey traces */
+void bintrace_write(bintrace_t* trace, char op, unsigned long long addr,
+                    unsigned int len);
+
+/*
+ * Open path for streaming reads, setting flags from its header. Returns NULL
+ * if it cannot be opened or does not start with BINTRACE_MAGIC (e.g. it is
+ * a text trace).
+ */
+bintrace_t* bintrace_open_read(const char* path);
+
+/* Read the next record. Returns 1 on success and 0 at the end of the trace. */
+int bintrace_read(bintrace_t* trace, char* op, unsigned long long* addr,
+                  unsigned int* len);
+
+/* Flush and close a trace opened for reading or writing */
+void bintrace_close(bintrace_t* trace);
+
+#endif /* BINTRACE_H */
@@ -0,0 +1,275 @@
+/*
+ * cache-infer.c - The cache geometry inference in cache-infer.h.
+ *
+ * Every experiment is a pattern of block addresses: consecutive blocks,
+ * which spread evenly over the sets; blocks a power-of-two stride apart
+ * that is at least the cache size, which all land in one set; or two such
+ * columns interleaved, which land in two neighbouring sets. Two questions
+ * are asked of a pattern:
+ *
+ *   fits(p, n)     After touching its first n blocks, are all n still
+ *                  cached? That holds exactly when n does not exceed what
+ *                  the pattern's sets (plus the victim buffer) can hold,
+ *                  whatever the replacement policy, so a doubling and
+ *                  bisection search on n finds that capacity.
+ *
+ *   resident(p, n) After touching n blocks, how many of the last ones are
+ *                  still cached, probing newest first? Under LRU and FIFO
+ *                  the survivors are always a suffix of the pattern, and
+ *                  probing them newest first evicts nothing, so one pass
+ *                  finds the capacity directly. Random replacement breaks
+ *                  the suffix property, so it falls back to bisection.
+ *
+ * The searches run from the cheapest to the most expensive, and each one
+ * narrows the next: the block size, a power-of-two bound on the capacity,
+ * the number of blocks one set holds (with the victim buffer), whether the
+ * policy is LRU/FIFO, the exact capacity, and finally the victim buffer,
+ * which two sets share but one set cannot tell apart from more ways.
+ */
+#include <stdio.h>
+#include "mystery-cache.h"
+#include "cache-infer.h"
+
+/* Largest block size and capacity the searches will consider */
+#define MAX_BLOCK_SIZE (1 << 20)
+#define MAX_BLOCKS (1 << 22)
+
+/* Sweeps over one more block than a set holds, when testing for random */
+#define RANDOM_SWEEPS 4
+
+typedef struct pattern {
+    addr_t stride;          /* between consecutive blocks of a column */
+    addr_t second;          /* offset of the second column, 0 for one */
+} pattern_t;
+
+/* Per thread, so each of infer-sweep's threads counts its own */
+static _Thread_local unsigned long long calls = 0;
+
+/*
+ * probe - Access addr, counting the call
+ */
+static int probe(addr_t addr) {
+    calls++;
+    return access_cache(addr) == TRUE;
+}
+
+/*
+ * block_addr - Address of block i of p. With two columns, even blocks are
+ *     in the first and odd blocks in the second.
+ */
+static addr_t block_addr(const pattern_t* p, int i) {
+    if (p->second == 0)
+        return (addr_t) i * p->stride;
+    return (addr_t) (i / 2) * p->stride + (i % 2) * p->second;
+}
+
+/*
+ * fits - Report whether the first n blocks of p are all cached after
+ *     touching each of them once
+ */
+static int fits(const pattern_t* p, int n) {
+    int i;
+
+    flush_cache();
+    for (i = 0; i < n; i++)
+        probe(block_addr(p, i));
+    for (i = 0; i < n; i++)
+        if (!probe(block_addr(p, i)))
+            return 0;
+    return 1;
+}
+
+/*
+ * resident - Touch the first n blocks of p, then count how many of the
+ *     newest ones are still cached before the first miss
+ */
+static int resident(const pattern_t* p, int n) {
+    int i;
+
+    flush_cache();
+    for (i = 0; i < n; i++)
+        probe(block_addr(p, i));
+    for (i = n - 1; i >= 0; i--)
+        if (!probe(block_addr(p, i)))
+            break;
+    return n - 1 - i;
+}
+
+/*
+ * largest_fit - The largest n in [lo, hi) with fits(p, n), given that lo
+ *     fits and hi does not
+ */
+static int largest_fit(const pattern_t* p, int lo, int hi) {
+    while (hi - lo > 1) {
+        int mid = lo + (hi - lo) / 2;
+        if (fits(p, mid))
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * first_misfit - Double n from 1 until fits(p, n) fails, and return that
+ *     n (or limit if it never does)
+ */
+static int first_misfit(const pattern_t* p, int limit) {
+    int n = 1;
+    while (n < limit && fits(p, n))
+        n *= 2;
+    return n;
+}
+
+/*
+ * infer_block_size - For offsets of 1, 2, 4, ... bytes, bring in the
+ *     block at that offset and check whether address 0 came with it: the
+ *     first offset for which it did not is the block size. Touching the
+ *     higher address first keeps a next-line prefetcher, as on real
+ *     hardware, from bringing address 0 in too.
+ */
+int infer_block_size(void) {
+    addr_t offset;
+
+    for (offset = 1; offset < MAX_BLOCK_SIZE; offset *= 2) {
+        flush_cache();
+        probe(offset);
+        if (!probe(0))
+            return (int) offset;
+    }
+    return -1;
+}
+
+/*
+ * is_random - Sweep cyclically over one block more than a set holds. LRU
+ *     and FIFO both evict each block just before it is needed again, so
+ *     every access misses; a policy that picks victims at random keeps
+ *     some of them.
+ */
+static int is_random(const pattern_t* one_set, int set_blocks) {
+    int round, i, hits = 0;
+
+    flush_cache();
+    for (round = 0; round < RANDOM_SWEEPS; round++)
+        for (i = 0; i <= set_blocks; i++)
+            hits += probe(block_addr(one_set, i));
+    return hits > 0;
+}
+
+/*
+ * is_lru - Tell LRU from FIFO in a set of assoc ways and victims buffer
+ *     lines. Fill the set and buffer, so that block `victims` is the
+ *     oldest line left in the set, and use it again. Then bring in
+ *     victims + 1 new blocks. FIFO evicts block `victims` first and the
+ *     buffer loses it again; LRU keeps it in the set or buffer.
+ */
+static int is_lru(const pattern_t* one_set, int assoc, int victims) {
+    int i, set_blocks = assoc + victims;
+
+    flush_cache();
+    for (i = 0; i < set_blocks; i++)
+        probe(block_addr(one_set, i));
+    probe(block_addr(one_set, victims));
+    for (i = set_blocks; i <= set_blocks + victims; i++)
+        probe(block_addr(one_set, i));
+    return probe(block_addr(one_set, victims));
+}
+
+/*
+ * is_power_of_two - Is n a positive power of two?
+ */
+static int is_power_of_two(long long n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+/*
+ * possible - Could a cache with g's geometry exist, given the assumptions
+ *     in cache-infer.h? A noisy backend such as mystery-hw.c can leave the
+ *     searches with answers no cache has.
+ */
+static int possible(const cache_geometry_t* g) {
+    long long set_size = (long long) g->block_size * g->assoc;
+
+    return is_power_of_two(g->block_size) && g->assoc >= 1 && g->victim_lines >= 0
+           && g->cache_size > 0 && g->cache_size % set_size == 0
+           && is_power_of_two(g->cache_size / set_size);
+}
+
+/*
+ * infer_geometry - Run every search, in the order described at the top,
+ *     and leave cache_size, assoc and victim_lines at -1 if they do not add
+ *     up to a possible cache
+ */
+void infer_geometry(cache_geometry_t* g) {
+    pattern_t seq, one_set, two_sets;
+    int bound, total, set_blocks, pair_blocks, random;
+
+    g->block_size = infer_block_size();
+    g->cache_size = g->assoc = g->victim_lines = -1;
+    g->policy = INFER_POLICY_NONE;
+    if (g->block_size < 0)
+        return;
+
+    /* A power of two more blocks than the whole cache holds. Its size in
+       bytes is a multiple of the number of sets times the block size, so
+       it serves as the stride that maps blocks to one set. */
+    seq = (pattern_t) { g->block_size, 0 };
+    bound = first_misfit(&seq, MAX_BLOCKS);
+    if (bound >= MAX_BLOCKS)
+        return;
+    one_set = (pattern_t) { (addr_t) bound * g->block_size, 0 };
+    two_sets = (pattern_t) { one_set.stride, g->block_size };
+
+    /* Ways plus victim buffer lines available to a single set */
+    set_blocks = first_misfit(&one_set, bound);
+    set_blocks = largest_fit(&one_set, set_blocks / 2, set_blocks);
+    random = set_blocks > 1 && is_random(&one_set, set_blocks);
+
+    /* Every line in the sets and the victim buffer */
+    if (random)
+        total = largest_fit(&seq, bound / 2, bound);
+    else
+        total = resident(&seq, bound);
+
+    /* With one set, extra victim lines are indistinguishable from extra
+       ways. Otherwise two sets hold 2 * assoc + victims blocks. */
+    g->victim_lines = 0;
+    if (total > set_blocks) {
+        if (random)
+            pair_blocks = largest_fit(&two_sets, set_blocks, 2 * set_blocks + 1);
+        else
+            pair_blocks = resident(&two_sets, 2 * set_blocks + 2);
+        g->victim_lines = 2 * set_blocks - pair_blocks;
+    }
+    g->assoc = set_blocks - g->victim_lines;
+    g->cache_size = (total - g->victim_lines) * g->block_size;
+    if (!possible(g)) {
+        g->cache_size = g->assoc = g->victim_lines = -1;
+        return;
+    }
+
+    if (random)
+        g->policy = INFER_RANDOM;
+    else if (g->assoc > 1)
+        g->policy = is_lru(&one_set, g->assoc, g->victim_lines) ? INFER_LRU : INFER_FIFO;
+}
+
+/*
+ * infer_calls - Report the access_cache() calls this thread made so far
+ */
+unsigned long long infer_calls(void) {
+    return calls;
+}
+
+/*
+ * infer_policy_name - Name a policy for printing
+ */
+const char* infer_policy_name(infer_policy_t policy) {
+    switch (policy) {
+    case INFER_POLICY_NONE: return "none (direct-mapped)";
+    case INFER_LRU: return "LRU";
+    case INFER_FIFO: return "FIFO";
+    case INFER_RANDOM: return "random";
+    }
+    return "unknown";
+}
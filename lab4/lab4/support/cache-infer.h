@@ -0,0 +1,45 @@
+/*
+ * cache-infer.h - Infers the geometry and replacement policy of whatever
+ *     cache is behind mystery-cache.h (a mystery cache object, the cachesim
+ *     backend in mystery-sim.c, or the timing backend in mystery-hw.c),
+ *     using only access_cache() and flush_cache().
+ *
+ * The cache is assumed to be indexed by address bits, with power-of-two
+ * block sizes and set counts, and any victim buffer to be fully
+ * associative and to swap lines with the sets on a hit, as in cachesim.
+ * With a single set, victim lines cannot be told apart from extra ways, so
+ * they are folded into assoc. Pseudo-LRU and other policies that keep some
+ * lines of a cyclic sweep are reported as random.
+ */
+
+#ifndef CACHE_INFER_H
+#define CACHE_INFER_H
+
+typedef enum infer_policy {
+    INFER_POLICY_NONE,      /* direct-mapped, so there is no choice to make */
+    INFER_LRU,
+    INFER_FIFO,
+    INFER_RANDOM,           /* keeps some lines of a cyclic sweep */
+} infer_policy_t;
+
+typedef struct cache_geometry {
+    int block_size;         /* bytes */
+    int cache_size;         /* bytes, not counting the victim buffer */
+    int assoc;              /* lines per set */
+    int victim_lines;       /* victim buffer entries, 0 if there is none */
+    infer_policy_t policy;
+} cache_geometry_t;
+
+/* Infer the block size in bytes */
+int infer_block_size(void);
+
+/* Infer everything in cache_geometry_t */
+void infer_geometry(cache_geometry_t* g);
+
+/* Number of access_cache() calls made so far by the calling thread */
+unsigned long long infer_calls(void);
+
+/* "LRU", "FIFO", etc. */
+const char* infer_policy_name(infer_policy_t policy);
+
+#endif /* CACHE_INFER_H */
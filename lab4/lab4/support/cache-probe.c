@@ -0,0 +1,470 @@
+/*
+ * cache-probe.c - Measures this machine's cache hierarchy and TLBs, for
+ *     sizing data structures per machine type rather than trusting a
+ *     spec sheet. Prints:
+ *
+ *   - the line size, from chases over pairs of loads d bytes apart, each
+ *     pair at a random line out of L1 but in L2: the second load of a pair
+ *     hits in L1 while d is within the line, and costs an L2 hit once it
+ *     is not. The most common answer of several sweeps over d is taken,
+ *     and 64 bytes is assumed if no answer has a majority;
+ *   - each cache level's size and load latency, from pointer chases in
+ *     random order over working sets growing by quarter octaves (see
+ *     chase.h). Latency sits on a plateau while the working set fits in a
+ *     level and climbs to the next one once it does not; a level's size is
+ *     the largest working set still below the midpoint of the two;
+ *   - the associativity of every level but the last, by chasing k lines
+ *     that all map to one set: latency leaves the level's plateau once k
+ *     exceeds its ways. Lines that far apart also share TLB sets, so the
+ *     time for the same pages at lines in different sets is subtracted.
+ *     The last level cache is left out, since its slices are picked by a
+ *     hash of the physical address. Levels indexed by bits above 4 KiB
+ *     need the huge pages chase_alloc() asks for, and come out unknown on
+ *     virtual machines whose host backs them with small pages;
+ *   - each TLB level's entries, reach and miss cost, by chasing one line
+ *     per 4 KiB page and subtracting the time for as many lines packed
+ *     into as few pages as possible, which leaves only the TLB's share.
+ *
+ * Latencies are in clock.c cycles, which count at the time stamp counter's
+ * fixed rate rather than the core's, so they are also given in ns.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "clock.h"
+#include "chase.h"
+
+/* Default largest working set, in MiB; it must exceed the last level */
+#define DEFAULT_MAX_MB 512
+
+/* Smallest working set, and the steps between: 4, 5, 6, 7 times 2^k */
+#define MIN_WORKING_SET (4UL << 10)
+#define MAX_POINTS 128
+
+/* Line size sweeps that vote on the line size */
+#define LINE_VOTES 15
+
+/* Line size assumed when the sweeps do not agree */
+#define DEFAULT_LINE 64
+
+/* The pairs start PAIR_SPAN bytes apart, which bounds the line sizes a
+   sweep can find, over PAIR_REGION bytes: lines enough to overflow any L1
+   but few enough to fit any L2 */
+#define PAIR_SPAN 512
+#define PAIR_REGION (512UL << 10)
+
+/* A pair's second load has left the line once the pair costs this many
+   times what the closest pairs cost */
+#define LINE_JUMP 1.25
+
+/* Fewest loads per timed chase, so short chains are timed long enough */
+#define MIN_LOADS (1L << 18)
+
+/* Most ways tried per level */
+#define MAX_WAYS 32
+
+/* Most pages the TLB chases span; 64 MiB of 4 KiB pages */
+#define MAX_TLB_PAGES 16384
+
+/* A new level starts where latency passes LEVEL_JUMP times the current
+   one, and settles once a step raises it by less than LEVEL_SETTLE */
+#define LEVEL_JUMP 1.5
+#define LEVEL_SETTLE 1.05
+
+/* Slack for the TLB levels, whose first plateau is at 0 extra cycles */
+#define TLB_SLACK 2.0
+
+/* Most levels reported */
+#define MAX_LEVELS 8
+
+typedef struct level {
+    size_t size;            /* largest working set that fits, 0 for the last */
+    double cycles;          /* latency on its plateau */
+} level_t;
+
+static double mhz_rate;
+static int verbose = 0;
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[]) {
+    printf("Usage: %s [-hv] [-m <MiB>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -v          Print every latency measured.\n");
+    printf("  -m <MiB>    Largest working set to chase (default %d).\n", DEFAULT_MAX_MB);
+    printf("Example: %s -v -m 1024\n", argv[0]);
+}
+
+/*
+ * print_size - Print a byte count in the largest unit that divides it
+ */
+static void print_size(size_t bytes) {
+    if (bytes >= (1UL << 20) && bytes % (1UL << 20) == 0)
+        printf("%zu MiB", bytes >> 20);
+    else if (bytes >= (1UL << 10) && bytes % (1UL << 10) == 0)
+        printf("%zu KiB", bytes >> 10);
+    else
+        printf("%zu bytes", bytes);
+}
+
+/*
+ * working_sets - Fill sizes with 4, 5, 6 and 7 KiB times each power of
+ *     two up to max, and return how many there are
+ */
+static int working_sets(size_t max, size_t* sizes) {
+    size_t octave;
+    int step, n = 0;
+
+    for (octave = MIN_WORKING_SET; octave <= max; octave *= 2)
+        for (step = 4; step < 8 && n < MAX_POINTS; step++)
+            if (octave / 4 * step <= max)
+                sizes[n++] = octave / 4 * step;
+    return n;
+}
+
+/*
+ * compare_cycles - qsort order for latencies
+ */
+static int compare_cycles(const void* a, const void* b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * median - Median of n latencies
+ */
+static double median(const double* cycles, int n) {
+    double sorted[MAX_POINTS];
+
+    memcpy(sorted, cycles, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), compare_cycles);
+    return sorted[n / 2];
+}
+
+/*
+ * find_levels - Split a latency curve into plateaus, as described at the
+ *     top. slack is added to every jump test, for curves that start at 0.
+ *     A level's latency is the median of its plateau, from where it
+ *     settles to where the next level starts. Returns the number of levels.
+ */
+static int find_levels(const size_t* sizes, const double* cycles, int n, double slack,
+                       level_t* levels) {
+    int jumped[MAX_LEVELS], settled[MAX_LEVELS];
+    int count = 1, i, j, k;
+    double mid;
+
+    jumped[0] = settled[0] = 0;
+    levels[0].cycles = cycles[0];
+    for (i = 1; i < n && count < MAX_LEVELS; i++) {
+        /* A jump must hold for the next point too, so one slow
+           measurement does not start a level */
+        if (cycles[i] <= levels[count - 1].cycles * LEVEL_JUMP + slack
+            || (i + 1 < n && cycles[i + 1] <= levels[count - 1].cycles * LEVEL_JUMP + slack))
+            continue;
+        for (j = i; j + 1 < n && cycles[j + 1] > cycles[j] * LEVEL_SETTLE; j++)
+            ;
+        jumped[count] = i;
+        settled[count] = j;
+        levels[count++].cycles = cycles[j];
+        i = j;
+    }
+
+    for (k = 0; k < count; k++)
+        levels[k].cycles = median(cycles + settled[k],
+                                  (k + 1 < count ? jumped[k + 1] : n) - settled[k]);
+    for (k = 0; k + 1 < count; k++) {
+        mid = (levels[k].cycles + levels[k + 1].cycles) / 2;
+        for (j = settled[k + 1]; j >= jumped[k + 1] && cycles[j] >= mid; j--)
+            ;
+        levels[k].size = sizes[j];
+    }
+    levels[count - 1].size = 0;
+    return count;
+}
+
+/*
+ * pair_cycles - Cycles per load chasing pairs of lines d bytes apart,
+ *     the pairs starting at the shuffled offsets in starts
+ */
+static double pair_cycles(char* base, const size_t* starts, size_t* offsets,
+                          size_t n, int d) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        offsets[2 * i] = starts[i];
+        offsets[2 * i + 1] = starts[i] + d;
+    }
+    chase_link(base, offsets, 2 * n);
+    return chase_cycles(base, offsets[0], MIN_LOADS);
+}
+
+/*
+ * line_sweep - The smallest d at which the pair chase jumps above the
+ *     cost of the closest pairs, or -1 if it never does
+ */
+static int line_sweep(char* base, const size_t* starts, size_t* offsets, size_t n) {
+    int d = sizeof(void*);
+    double closest = pair_cycles(base, starts, offsets, n, d);
+
+    for (d *= 2; d < PAIR_SPAN; d *= 2)
+        if (pair_cycles(base, starts, offsets, n, d) > closest * LINE_JUMP)
+            return d;
+    return -1;
+}
+
+/*
+ * line_size - The most common of LINE_VOTES line_sweep() answers, or
+ *     DEFAULT_LINE with a warning if it is not a majority
+ */
+static int line_size(int* agreed) {
+    size_t n = PAIR_REGION / PAIR_SPAN, i;
+    char* base = chase_alloc(PAIR_REGION, 1);
+    size_t* starts = malloc(n * sizeof(size_t));
+    size_t* offsets = malloc(2 * n * sizeof(size_t));
+    int votes[LINE_VOTES], j, count, best = -1;
+
+    if (starts == NULL || offsets == NULL) {
+        printf("Unable to allocate %zu chase offsets\n", 3 * n);
+        exit(1);
+    }
+    for (i = 0; i < n; i++)
+        starts[i] = i * PAIR_SPAN;
+    chase_shuffle(starts, n, n);
+    for (i = 0; i < LINE_VOTES; i++)
+        votes[i] = line_sweep(base, starts, offsets, n);
+    free(starts);
+    free(offsets);
+    free(base);
+
+    *agreed = 0;
+    for (i = 0; i < LINE_VOTES; i++) {
+        for (count = 0, j = 0; j < LINE_VOTES; j++)
+            count += votes[j] == votes[i];
+        if (count > *agreed) {
+            *agreed = count;
+            best = votes[i];
+        }
+    }
+    if (best < 0 || *agreed <= LINE_VOTES / 2) {
+        if (best < 0)
+            fprintf(stderr, "Warning: the line size sweeps found no jump");
+        else
+            fprintf(stderr, "Warning: only %d of %d line size sweeps agree on %d bytes",
+                    *agreed, LINE_VOTES, best);
+        fprintf(stderr, "; assuming %d bytes\n", DEFAULT_LINE);
+        *agreed = 0;
+        return DEFAULT_LINE;
+    }
+    return best;
+}
+
+/*
+ * random_chase - Cycles per load over `bytes` bytes, one slot per line in
+ *     a random order
+ */
+static double random_chase(char* base, size_t* offsets, size_t bytes, int line) {
+    size_t i, n = bytes / line;
+
+    for (i = 0; i < n; i++)
+        offsets[i] = i * line;
+    chase_shuffle(offsets, n, bytes);
+    chase_link(base, offsets, n);
+    return chase_cycles(base, offsets[0], n > MIN_LOADS ? (long) n : MIN_LOADS);
+}
+
+/*
+ * measure_caches - Chase every working set up to max, and split the curve
+ *     into levels. Returns the number of levels, the last being memory.
+ */
+static int measure_caches(size_t max, int line, level_t* levels) {
+    static size_t sizes[MAX_POINTS];
+    static double cycles[MAX_POINTS];
+    char* base = chase_alloc(max, 1);
+    size_t* offsets = malloc(max / line * sizeof(size_t));
+    int i, n = working_sets(max, sizes);
+
+    if (offsets == NULL) {
+        printf("Unable to allocate %zu chase offsets\n", max / line);
+        exit(1);
+    }
+    if (verbose)
+        printf("\nWorking set      Cycles/load\n");
+    for (i = 0; i < n; i++) {
+        cycles[i] = random_chase(base, offsets, sizes[i], line);
+        if (verbose) {
+            printf("%10zu KiB  %10.1f\n", sizes[i] >> 10, cycles[i]);
+            fflush(stdout);
+        }
+    }
+    free(offsets);
+    free(base);
+    return find_levels(sizes, cycles, n, 0, levels);
+}
+
+/*
+ * same_set_share - Cycles per load over k lines `stride` apart, minus the
+ *     same lines each moved to a different set. The lines share a set in
+ *     the first chase but not the second, while both touch the same pages,
+ *     so this leaves out the TLB misses a large stride causes.
+ */
+static double same_set_share(char* base, size_t stride, int k, int line) {
+    size_t offsets[MAX_WAYS + 1];
+    double cycles;
+    int i;
+
+    for (i = 0; i < k; i++)
+        offsets[i] = i * stride;
+    chase_link(base, offsets, k);
+    cycles = chase_cycles(base, 0, MIN_LOADS);
+    for (i = 0; i < k; i++)
+        offsets[i] = i * stride + i * line;
+    chase_link(base, offsets, k);
+    return cycles - chase_cycles(base, 0, MIN_LOADS);
+}
+
+/*
+ * ways - Associativity of a level of the given size, whose latency is
+ *     `hit` and whose misses cost `miss`: chase k lines a power of two at
+ *     least the size apart, so that they share a set, and return the
+ *     largest k whose same-set share stays below half the miss cost.
+ *     Returns -1 if it never leaves the plateau, or the buffer is too
+ *     small for the stride.
+ */
+static int ways(char* base, size_t bytes, size_t level_size, int line, double hit, double miss) {
+    size_t stride = 1;
+    double share;
+    int k;
+
+    while (stride < level_size)
+        stride *= 2;
+    if (stride * (MAX_WAYS + 1) > bytes)
+        return -1;
+    if (verbose)
+        printf("\nStride      Lines  Same-set share\n");
+    for (k = 1; k <= MAX_WAYS + 1; k++) {
+        share = same_set_share(base, stride, k, line);
+        if (verbose)
+            printf("%6zu KiB  %5d  %14.1f\n", stride >> 10, k, share);
+        if (share >= (miss - hit) / 2)
+            return k - 1;
+    }
+    return -1;
+}
+
+/*
+ * measure_tlbs - Chase one line per page over 8 to MAX_TLB_PAGES pages,
+ *     minus the same number of lines packed together, and split the extra
+ *     cycles into levels. Each line sits at a different offset in its
+ *     page, so that the lines spread over the cache sets.
+ */
+static int measure_tlbs(int line, level_t* levels) {
+    static size_t sizes[MAX_POINTS];
+    static double extra[MAX_POINTS];
+    size_t offsets[MAX_TLB_PAGES], pages, i;
+    char* spread = chase_alloc(MAX_TLB_PAGES * CHASE_SMALL_PAGE, 0);
+    char* packed = chase_alloc((size_t) MAX_TLB_PAGES * line, 0);
+    double cycles;
+    int lines_per_page = CHASE_SMALL_PAGE / line, n = 0;
+
+    if (verbose)
+        printf("\nPages      Cycles/load    TLB share\n");
+    for (pages = 8; pages <= MAX_TLB_PAGES && n < MAX_POINTS;
+         pages = pages & (pages - 1) ? pages / 3 * 4 : pages / 2 * 3) {
+        for (i = 0; i < pages; i++)
+            offsets[i] = i * CHASE_SMALL_PAGE + i % lines_per_page * line;
+        chase_shuffle(offsets, pages, pages);
+        chase_link(spread, offsets, pages);
+        cycles = chase_cycles(spread, offsets[0], MIN_LOADS);
+        extra[n] = cycles - random_chase(packed, offsets, pages * line, line);
+        sizes[n++] = pages;
+        if (verbose)
+            printf("%5zu  %15.1f  %11.1f\n", pages, cycles, extra[n - 1]);
+    }
+    free(spread);
+    free(packed);
+    return find_levels(sizes, extra, n, TLB_SLACK, levels);
+}
+
+/*
+ * print_cycles - Print a latency in cycles and ns
+ */
+static void print_cycles(double cycles) {
+    printf("%.1f cycles (%.1f ns)", cycles, cycles * 1000 / mhz_rate);
+}
+
+int main(int argc, char* argv[]) {
+    level_t caches[MAX_LEVELS], tlbs[MAX_LEVELS];
+    size_t max = (size_t) DEFAULT_MAX_MB << 20;
+    int line, agreed, num_caches, num_tlbs, i, assoc;
+    char* base;
+    char c;
+
+    while ((c = getopt(argc, argv, "hvm:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv);
+            exit(0);
+        case 'v':
+            verbose = 1;
+            break;
+        case 'm':
+            max = (size_t) atol(optarg) << 20;
+            break;
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (max < MIN_WORKING_SET) {
+        usage(argv);
+        exit(1);
+    }
+
+    line = line_size(&agreed);
+    mhz_rate = mhz_full(0, 1);
+    printf("Cycle counter: %.0f MHz\n", mhz_rate);
+    if (agreed > 0)
+        printf("Line size: %d bytes (%d of %d runs agree)\n", line, agreed, LINE_VOTES);
+    else
+        printf("Line size: %d bytes (assumed)\n", line);
+
+    num_caches = measure_caches(max, line, caches);
+    if (num_caches < 2) {
+        printf("No cache levels found below %zu MiB\n", max >> 20);
+        exit(1);
+    }
+    base = chase_alloc(max, 1);
+    for (i = 0; i < num_caches - 1; i++) {
+        assoc = i < num_caches - 2
+            ? ways(base, max, caches[i].size, line, caches[i].cycles, caches[i + 1].cycles) : -1;
+        printf("L%d%s: ", i + 1, i == num_caches - 2 ? " (LLC)" : "");
+        print_size(caches[i].size);
+        if (assoc > 0)
+            printf(", %d-way", assoc);
+        else if (i < num_caches - 2)
+            printf(", associativity unknown");
+        printf(", ");
+        print_cycles(caches[i].cycles);
+        printf("\n");
+    }
+    free(base);
+    printf("Memory: ");
+    print_cycles(caches[num_caches - 1].cycles);
+    printf("\n");
+
+    num_tlbs = measure_tlbs(line, tlbs);
+    for (i = 0; i < num_tlbs - 1; i++) {
+        printf("L%d TLB: %zu entries, ", i + 1, tlbs[i].size);
+        print_size(tlbs[i].size * CHASE_SMALL_PAGE);
+        printf(" reach, a miss adds ");
+        print_cycles(tlbs[i + 1].cycles);
+        printf("\n");
+    }
+    if (num_tlbs < 2)
+        printf("TLB: no misses within %d pages\n", MAX_TLB_PAGES);
+    return 0;
+}
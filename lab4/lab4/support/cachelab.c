@@ -1,11 +1,17 @@
 /*
  * cachelab.c - Cache Lab helper functions
  */
+#define _POSIX_C_SOURCE 200809L  /* for sysconf() under -std=c18 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "cachelab.h"
-#include <time.h>
+
+/* Matrices of at least FILL_PARALLEL_MIN ints are filled by several threads */
+#define FILL_PARALLEL_MIN (1 << 20)
+#define FILL_MAX_THREADS 64
 
 trans_func_t func_list[MAX_TRANS_FUNCS];
 int func_counter = 0;
@@ -22,30 +28,119 @@ void printSummary(int hits, int misses, int evictions) {
     fclose(output_fp);
 }
 
+/* Seed for initMatrix() and randMatrix(); see setMatrixSeed() */
+static unsigned long long matrix_seed = CACHELAB_DEFAULT_SEED;
+
+/*
+ * setMatrixSeed - Choose the values initMatrix() and randMatrix() fill in
+ */
+void setMatrixSeed(unsigned long long seed) {
+    matrix_seed = seed;
+}
+
+/*
+ * matrix_value - Element i of stream number stream: splitmix64's output
+ *     function applied to a counter, so any element can be computed on its
+ *     own, in any order, by any thread. The result is in [0, 2^31) like
+ *     rand()'s.
+ */
+static int matrix_value(unsigned long long stream, size_t i) {
+    unsigned long long z;
+
+    z = (matrix_seed ^ (stream * 0xd1b54a32d192ed03ULL))
+        + (i + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (int) (z >> 33);
+}
+
+/* One thread's share of a fill */
+struct fill_range {
+    int* dst;
+    unsigned long long stream;
+    size_t lo, hi;
+};
+
+/*
+ * fill_range - Fill dst[lo..hi) with elements lo..hi of the stream
+ */
+static void* fill_range(void* arg) {
+    struct fill_range* r = arg;
+    size_t i;
+
+    for (i = r->lo; i < r->hi; i++)
+        r->dst[i] = matrix_value(r->stream, i);
+    return NULL;
+}
+
+/*
+ * fill_matrix - Fill the n ints at dst from the stream. Large matrices are
+ *     split into contiguous ranges, one per CPU; since every element only
+ *     depends on its index, the values come out the same however many
+ *     threads there are, or if a thread cannot be started and its range
+ *     is filled here instead.
+ */
+static void fill_matrix(int* dst, size_t n, unsigned long long stream) {
+    struct fill_range ranges[FILL_MAX_THREADS];
+    pthread_t threads[FILL_MAX_THREADS];
+    char started[FILL_MAX_THREADS];
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = 1, t;
+
+    if (n >= FILL_PARALLEL_MIN && cpus > 1)
+        nthreads = cpus < FILL_MAX_THREADS ? (int) cpus : FILL_MAX_THREADS;
+    for (t = 0; t < nthreads; t++) {
+        ranges[t].dst = dst;
+        ranges[t].stream = stream;
+        ranges[t].lo = n * t / nthreads;
+        ranges[t].hi = n * (t + 1) / nthreads;
+    }
+    /* Thread 0's range is filled by the caller */
+    for (t = 1; t < nthreads; t++)
+        started[t] = pthread_create(&threads[t], NULL, fill_range, &ranges[t]) == 0;
+    fill_range(&ranges[0]);
+    for (t = 1; t < nthreads; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            fill_range(&ranges[t]);
+    }
+}
+
 /* 
  * initMatrix - Initialize the given matrix 
  */
 void initMatrix(int M, int N, int A[M][N], int B[N][M]) {
-    int i, j;
-    srand(time(NULL));
-    for (i = 0; i < M; i++) {
-        for (j = 0; j < N; j++) {
-            // A[i][j] = i+j;  /* The matrix created this way is symmetric */
-            A[i][j] = rand();
-            B[j][i] = rand();
-        }
-    }
+    fill_matrix(&A[0][0], (size_t) M * N, 0);
+    fill_matrix(&B[0][0], (size_t) M * N, 1);
 }
 
+/*
+ * randMatrix - Fill A alone, with the same values initMatrix() gives it
+ */
 void randMatrix(int M, int N, int A[M][N]) {
-    int i, j;
-    srand(time(NULL));
-    for (i = 0; i < M; i++) {
-        for (j = 0; j < N; j++) {
-            // A[i][j] = i+j;  /* The matrix created this way is symmetric */
-            A[i][j] = rand();
-        }
+    fill_matrix(&A[0][0], (size_t) M * N, 0);
+}
+
+/*
+ * allocOperands - Lay the operands out OPERAND_ALIGN-aligned in one arena
+ */
+int* allocOperands(int n, const size_t len[], int* ops[]) {
+    size_t offsets[n], total = 0;
+    char* arena;
+    int k;
+
+    for (k = 0; k < n; k++) {
+        offsets[k] = total;
+        total += (sizeof(int) * len[k] + OPERAND_ALIGN - 1) & ~(OPERAND_ALIGN - 1);
     }
+    arena = aligned_alloc(OPERAND_ALIGN, total > 0 ? total : OPERAND_ALIGN);
+    if (arena == NULL)
+        return NULL;
+    for (k = 0; k < n; k++)
+        ops[k] = (int*) (arena + offsets[k]);
+    return (int*) arena;
 }
 
 /* 
@@ -70,10 +165,55 @@ void correctTrans(int M, int N, int A[M][N], int B[N][M]) {
 void registerTransFunction(void (*trans)(int M, int N, int[M][N], int[N][M]),
                            char* desc) {
     func_list[func_counter].func_ptr = trans;
+    func_list[func_counter].kind = KERNEL_TRANSPOSE;
     func_list[func_counter].description = desc;
     func_list[func_counter].correct = 0;
+    func_list[func_counter].in_place = 0;
     func_list[func_counter].num_hits = 0;
     func_list[func_counter].num_misses = 0;
     func_list[func_counter].num_evictions =0;
     func_counter++;
 }
+
+/* 
+ * registerInPlaceTransFunction - Add the given in-place trans function
+ *     into your list of functions to be tested
+ */
+void registerInPlaceTransFunction(void (*trans)(int M, int N, int[M][N], int[N][M]),
+                                  char* desc) {
+    registerTransFunction(trans, desc);
+    func_list[func_counter - 1].in_place = 1;
+}
+
+/*
+ * registerGemmFunction - Add the given matrix multiply function into the
+ *     list of functions to be tested
+ */
+void registerGemmFunction(void (*gemm)(int M, int N, int[M][N], int[N][M], int[M][M]),
+                          char* desc) {
+    registerTransFunction(NULL, desc);
+    func_list[func_counter - 1].gemm_ptr = gemm;
+    func_list[func_counter - 1].kind = KERNEL_GEMM;
+}
+
+/*
+ * registerStencilFunction - Add the given stencil function into the list
+ *     of functions to be tested
+ */
+void registerStencilFunction(void (*stencil)(int M, int N, int[M][N], int[M][N]),
+                             char* desc) {
+    registerTransFunction(NULL, desc);
+    func_list[func_counter - 1].stencil_ptr = stencil;
+    func_list[func_counter - 1].kind = KERNEL_STENCIL;
+}
+
+/*
+ * registerMatvecFunction - Add the given matrix-vector function into the
+ *     list of functions to be tested
+ */
+void registerMatvecFunction(void (*matvec)(int M, int N, int[M][N], int[N], int[M]),
+                            char* desc) {
+    registerTransFunction(NULL, desc);
+    func_list[func_counter - 1].matvec_ptr = matvec;
+    func_list[func_counter - 1].kind = KERNEL_MATVEC;
+}
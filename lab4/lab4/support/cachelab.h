@@ -5,12 +5,30 @@
 #ifndef CACHELAB_TOOLS_H
 #define CACHELAB_TOOLS_H
 
+#include <stddef.h>
+
 #define MAX_TRANS_FUNCS 100
 
+/* Seed initMatrix() and randMatrix() use unless setMatrixSeed() is called */
+#define CACHELAB_DEFAULT_SEED 0x15213ULL
+
+/* What a registered function computes; see support/kernels.h */
+#define KERNEL_TRANSPOSE 0  /* B = A^T, the lab's own kernels */
+#define KERNEL_GEMM 1       /* C = A B, A M x N, B N x M, C M x M */
+#define KERNEL_STENCIL 2    /* one 5-point Jacobi sweep, A to B, both M x N */
+#define KERNEL_MATVEC 3     /* y = A x, A M x N */
+
 typedef struct trans_func{
-  void (*func_ptr)(int M,int N,int[M][N],int[N][M]);
+  union {                   /* the member for kind */
+    void (*func_ptr)(int M,int N,int[M][N],int[N][M]);
+    void (*gemm_ptr)(int M,int N,int[M][N],int[N][M],int[M][M]);
+    void (*stencil_ptr)(int M,int N,int[M][N],int[M][N]);
+    void (*matvec_ptr)(int M,int N,int[M][N],int[N],int[M]);
+  };
+  char kind;
   char* description;
   char correct;
+  char in_place;   /* transposes B in place; the harness copies A into B first */
   unsigned int num_hits;
   unsigned int num_misses;
   unsigned int num_evictions;
@@ -24,9 +42,35 @@ void printSummary(int hits,  /* number of  hits */
 				  int misses, /* number of misses */
 				  int evictions); /* number of evictions */
 
-/* Fill the matrix with data */
+/*
+ * Fill the matrix with data. The values are pseudo-random but depend only
+ * on the seed and the position of each element, so every run with the
+ * same seed and sizes sees the same matrices, however many threads fill
+ * them.
+ */
 void initMatrix(int M, int N, int A[M][N], int B[N][M]);
 
+/* Fill A alone, as initMatrix() would */
+void randMatrix(int M, int N, int A[M][N]);
+
+/* Seed the values initMatrix() and randMatrix() fill in */
+void setMatrixSeed(unsigned long long seed);
+
+/*
+ * Operands allocOperands() lays out are aligned to OPERAND_ALIGN and start
+ * a multiple of it apart, as the static 256x256 A and B test-trans used to
+ * have: every operand then starts in set 0 of any cache up to 256 KiB, so
+ * miss counts do not depend on where malloc() put it.
+ */
+#define OPERAND_ALIGN (256UL << 10)
+
+/*
+ * Carve n operands of len[k] ints out of one arena, in order, and point
+ * ops[k] at each. Returns the arena to free(), or NULL if it could not be
+ * allocated.
+ */
+int* allocOperands(int n, const size_t len[], int* ops[]);
+
 /* The baseline trans function that produces correct results. */
 void correctTrans(int M, int N, int A[M][N], int B[N][M]);
 
@@ -34,4 +78,27 @@ void correctTrans(int M, int N, int A[M][N], int B[N][M]);
 void registerTransFunction(
     void (*trans)(int M,int N,int[M][N],int[N][M]), char* desc);
 
+/* 
+ * Add an in-place function to the function list. Before calling it, the
+ * harness copies A into B (still as an M x N matrix); the function must
+ * leave the N x M transpose in B and may ignore A.
+ */
+void registerInPlaceTransFunction(
+    void (*trans)(int M,int N,int[M][N],int[N][M]), char* desc);
+
+/* Add a C = A B kernel; it must write every element of C */
+void registerGemmFunction(
+    void (*gemm)(int M,int N,int[M][N],int[N][M],int[M][M]), char* desc);
+
+/*
+ * Add a stencil kernel: B[i][j] is the average of A[i][j] and its four
+ * neighbours, rounded toward zero, and the border of B is copied from A
+ */
+void registerStencilFunction(
+    void (*stencil)(int M,int N,int[M][N],int[M][N]), char* desc);
+
+/* Add a y = A x kernel */
+void registerMatvecFunction(
+    void (*matvec)(int M,int N,int[M][N],int[N],int[M]), char* desc);
+
 #endif /* CACHELAB_TOOLS_H */
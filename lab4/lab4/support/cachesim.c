@@ -0,0 +1,712 @@
+/*
+ * cachesim.c - An in-process cache simulator with the same parameters and
+ *     counting rules as csim-ref, so a transpose can be scored without
+ *     writing out and replaying a trace. Beyond csim-ref it models FIFO,
+ *     random and tree-PLRU replacement, dirty lines, victim buffers,
+ *     prefetchers and up to three levels.
+ *
+ * Lines store their whole block address (addr >> b) rather than just the
+ * tag, so a dirty line can be written back and a victim buffer searched
+ * without reconstructing the address from the set index.
+ *
+ * Miss classification follows the 3C model: a miss is compulsory if the
+ * level has never seen the block, a capacity miss if a fully-associative
+ * LRU cache with as many lines (the level's "shadow") misses as well, and a
+ * conflict miss otherwise. The shadow is a hash table of its lines chained
+ * into a recency list, so it costs O(1) per access however large it is.
+ *
+ * Prefetchers act only on demand accesses (not writebacks or other
+ * prefetches) and fill the block like a miss would, without counting a hit
+ * or miss at their own level; the fetch from the next level counts there.
+ * The stride prefetcher follows the usual per-instruction design: a small
+ * table, indexed by the low bits of the pc as in hardware, remembers the
+ * last block and block stride seen from each instruction, and once the
+ * same nonzero stride repeats it fetches one stride ahead. Prefetched
+ * blocks stay out of the 3C classification, so a prefetched block that is
+ * later missed on may count as compulsory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cachesim.h"
+
+#define NIL ((unsigned int) -1)
+
+/* Entries in each level's stride prefetcher table, a power of two */
+#define STRIDE_ENTRIES 64
+
+/* Repeats of a stride before the stride prefetcher acts on it */
+#define STRIDE_CONFIDENCE 1
+
+typedef struct stride_entry {
+    unsigned long long pc;
+    unsigned long long last;        /* last block accessed from pc */
+    long long stride;               /* in blocks */
+    int confidence;                 /* times stride has repeated */
+} stride_entry_t;
+
+typedef struct shadow_line {
+    unsigned long long block;
+    unsigned int prev, next;        /* toward the MRU and LRU ends */
+    unsigned int chain;             /* next line in the same hash bucket */
+} shadow_line_t;
+
+/* What a level needs to classify its misses */
+typedef struct classifier {
+    unsigned long long* seen;       /* open-addressed set of block + 1 */
+    size_t seen_size;               /* slots, a power of two */
+    size_t seen_count;
+    shadow_line_t* lines;           /* the fully-associative LRU shadow */
+    unsigned int* buckets;          /* heads of the hash chains */
+    size_t num_lines;
+    size_t num_buckets;             /* a power of two */
+    size_t used;
+    unsigned int mru, lru;
+} classifier_t;
+
+typedef struct cache_line {
+    int valid;
+    int dirty;
+    unsigned long long block;       /* addr >> b */
+    unsigned long long stamp;       /* last use (LRU) or fill (FIFO) time */
+    int prefetched;                 /* filled by the prefetcher, not used yet */
+} cache_line_t;
+
+typedef struct cache_level {
+    cache_config_t config;
+    cache_line_t* lines;            /* 2^s sets of E lines, set-major */
+    unsigned char* plru;            /* E - 1 tree bits per set, for PLRU */
+    cache_line_t* victims;          /* victim buffer, LRU among its entries */
+    stride_entry_t* strides;        /* stride prefetcher table, or NULL */
+    unsigned long long clock;       /* incremented on every access */
+    cache_stats_t stats;
+    classifier_t* classifier;       /* NULL unless classifying misses */
+} cache_level_t;
+
+struct cache_sim {
+    int num_levels;
+    cache_level_t levels[CACHESIM_MAX_LEVELS];
+    unsigned long long rand_state;  /* xorshift state for CACHESIM_RANDOM */
+    unsigned long long pc;          /* from cachesim_set_pc() */
+};
+
+#define RAND_SEED 0x9e3779b97f4a7c15ULL
+
+static void level_access(cache_sim_t* sim, int lvl, unsigned long long addr,
+                         unsigned int len, int is_store, int demand);
+
+/*
+ * cachesim_create - Allocate an empty single-level LRU cache with 2^s sets
+ *     of E lines of 2^b bytes each
+ */
+cache_sim_t* cachesim_create(unsigned int s, unsigned int E, unsigned int b) {
+    cache_config_t config = { s, E, b, CACHESIM_LRU, 0, CACHESIM_PREFETCH_NONE };
+    return cachesim_create_hierarchy(&config, 1);
+}
+
+/*
+ * cachesim_create_hierarchy - Allocate an empty cache for each config,
+ *     levels[0] being L1
+ */
+cache_sim_t* cachesim_create_hierarchy(const cache_config_t* levels,
+                                       int num_levels) {
+    cache_sim_t* sim;
+    int i;
+
+    if (num_levels < 1 || num_levels > CACHESIM_MAX_LEVELS)
+        return NULL;
+    for (i = 0; i < num_levels; i++) {
+        unsigned int E = levels[i].E;
+        if (E == 0 || levels[i].s > 30 || levels[i].b > 30)
+            return NULL;
+        if (levels[i].policy == CACHESIM_PLRU && (E & (E - 1)) != 0)
+            return NULL;
+        if (levels[i].prefetch > CACHESIM_PREFETCH_STRIDE)
+            return NULL;
+    }
+
+    sim = calloc(1, sizeof(cache_sim_t));
+    if (sim == NULL)
+        return NULL;
+    sim->num_levels = num_levels;
+    for (i = 0; i < num_levels; i++) {
+        cache_level_t* L = &sim->levels[i];
+        size_t num_lines = (size_t) levels[i].E << levels[i].s;
+
+        L->config = levels[i];
+        L->lines = calloc(num_lines, sizeof(cache_line_t));
+        if (L->config.policy == CACHESIM_PLRU && L->config.E > 1)
+            L->plru = calloc(num_lines, 1);
+        if (L->config.victim_lines > 0)
+            L->victims = calloc(L->config.victim_lines, sizeof(cache_line_t));
+        if (L->config.prefetch == CACHESIM_PREFETCH_STRIDE)
+            L->strides = calloc(STRIDE_ENTRIES, sizeof(stride_entry_t));
+        if (L->lines == NULL
+            || (L->config.policy == CACHESIM_PLRU && L->config.E > 1 && L->plru == NULL)
+            || (L->config.victim_lines > 0 && L->victims == NULL)
+            || (L->config.prefetch == CACHESIM_PREFETCH_STRIDE && L->strides == NULL)) {
+            cachesim_free(sim);
+            return NULL;
+        }
+    }
+    cachesim_reset(sim);
+    return sim;
+}
+
+/*
+ * cachesim_free - Free a cache created by cachesim_create() or
+ *     cachesim_create_hierarchy()
+ */
+void cachesim_free(cache_sim_t* sim) {
+    int i;
+    if (sim == NULL)
+        return;
+    for (i = 0; i < sim->num_levels; i++) {
+        classifier_t* C = sim->levels[i].classifier;
+        free(sim->levels[i].lines);
+        free(sim->levels[i].plru);
+        free(sim->levels[i].victims);
+        free(sim->levels[i].strides);
+        if (C != NULL) {
+            free(C->seen);
+            free(C->lines);
+            free(C->buckets);
+            free(C);
+        }
+    }
+    free(sim);
+}
+
+/*
+ * classifier_reset - Forget every block the classifier has seen
+ */
+static void classifier_reset(classifier_t* C) {
+    memset(C->seen, 0, C->seen_size * sizeof(unsigned long long));
+    C->seen_count = 0;
+    memset(C->buckets, 0xff, C->num_buckets * sizeof(unsigned int));
+    C->used = 0;
+    C->mru = C->lru = NIL;
+}
+
+/*
+ * hash_block - Spread block addresses over a power-of-two table
+ */
+static size_t hash_block(unsigned long long block, size_t size) {
+    return (size_t) ((block * 0x9e3779b97f4a7c15ULL) >> 20) & (size - 1);
+}
+
+/*
+ * seen_insert - Add block to the set of blocks seen. Returns 1 if it was
+ *     already there.
+ */
+static int seen_insert(classifier_t* C, unsigned long long block) {
+    size_t i;
+
+    /* Keep the table at most half full, doubling it when needed */
+    if (2 * (C->seen_count + 1) > C->seen_size) {
+        size_t old_size = C->seen_size;
+        unsigned long long* old = C->seen;
+        unsigned long long* grown = calloc(2 * old_size, sizeof(unsigned long long));
+        if (grown == NULL) {
+            fprintf(stderr, "cachesim: out of memory classifying misses\n");
+            exit(1);
+        }
+        C->seen = grown;
+        C->seen_size = 2 * old_size;
+        for (i = 0; i < old_size; i++) {
+            size_t j;
+            if (old[i] == 0)
+                continue;
+            for (j = hash_block(old[i] - 1, C->seen_size); grown[j] != 0;
+                 j = (j + 1) & (C->seen_size - 1))
+                ;
+            grown[j] = old[i];
+        }
+        free(old);
+    }
+
+    for (i = hash_block(block, C->seen_size); C->seen[i] != 0;
+         i = (i + 1) & (C->seen_size - 1))
+        if (C->seen[i] == block + 1)
+            return 1;
+    C->seen[i] = block + 1;
+    C->seen_count++;
+    return 0;
+}
+
+/*
+ * shadow_unlink - Take line x out of the recency list
+ */
+static void shadow_unlink(classifier_t* C, unsigned int x) {
+    shadow_line_t* line = &C->lines[x];
+    if (line->prev != NIL)
+        C->lines[line->prev].next = line->next;
+    else
+        C->mru = line->next;
+    if (line->next != NIL)
+        C->lines[line->next].prev = line->prev;
+    else
+        C->lru = line->prev;
+}
+
+/*
+ * shadow_push_mru - Put line x at the most recently used end
+ */
+static void shadow_push_mru(classifier_t* C, unsigned int x) {
+    C->lines[x].prev = NIL;
+    C->lines[x].next = C->mru;
+    if (C->mru != NIL)
+        C->lines[C->mru].prev = x;
+    C->mru = x;
+    if (C->lru == NIL)
+        C->lru = x;
+}
+
+/*
+ * shadow_access - Look up block in the fully-associative LRU shadow and
+ *     make it the most recently used line. Returns 1 on a hit.
+ */
+static int shadow_access(classifier_t* C, unsigned long long block) {
+    size_t bucket = hash_block(block, C->num_buckets);
+    unsigned int x, *link;
+
+    for (x = C->buckets[bucket]; x != NIL; x = C->lines[x].chain) {
+        if (C->lines[x].block == block) {
+            shadow_unlink(C, x);
+            shadow_push_mru(C, x);
+            return 1;
+        }
+    }
+
+    if (C->used < C->num_lines) {
+        x = C->used++;
+    } else {
+        /* Reuse the LRU line, unhooking it from its hash chain first */
+        x = C->lru;
+        shadow_unlink(C, x);
+        link = &C->buckets[hash_block(C->lines[x].block, C->num_buckets)];
+        while (*link != x)
+            link = &C->lines[*link].chain;
+        *link = C->lines[x].chain;
+    }
+    C->lines[x].block = block;
+    C->lines[x].chain = C->buckets[bucket];
+    C->buckets[bucket] = x;
+    shadow_push_mru(C, x);
+    return 0;
+}
+
+/*
+ * cachesim_classify_misses - Give every level a classifier, so that its
+ *     misses are sorted into the 3C classes from now on
+ */
+int cachesim_classify_misses(cache_sim_t* sim) {
+    int i;
+
+    for (i = 0; i < sim->num_levels; i++) {
+        cache_level_t* L = &sim->levels[i];
+        classifier_t* C;
+
+        if (L->classifier != NULL)
+            continue;
+        C = calloc(1, sizeof(classifier_t));
+        if (C == NULL)
+            return 0;
+        L->classifier = C;
+        C->num_lines = (size_t) L->config.E << L->config.s;
+        for (C->num_buckets = 1; C->num_buckets < 2 * C->num_lines; C->num_buckets *= 2)
+            ;
+        C->seen_size = 1024;
+        C->seen = malloc(C->seen_size * sizeof(unsigned long long));
+        C->lines = malloc(C->num_lines * sizeof(shadow_line_t));
+        C->buckets = malloc(C->num_buckets * sizeof(unsigned int));
+        if (C->seen == NULL || C->lines == NULL || C->buckets == NULL)
+            return 0;
+        classifier_reset(C);
+    }
+    return 1;
+}
+
+/*
+ * cachesim_reset - Invalidate every line and zero the counters
+ */
+void cachesim_reset(cache_sim_t* sim) {
+    int i;
+    size_t j;
+
+    for (i = 0; i < sim->num_levels; i++) {
+        cache_level_t* L = &sim->levels[i];
+        size_t num_lines = (size_t) L->config.E << L->config.s;
+
+        for (j = 0; j < num_lines; j++)
+            L->lines[j].valid = 0;
+        if (L->plru != NULL)
+            for (j = 0; j < num_lines; j++)
+                L->plru[j] = 0;
+        for (j = 0; j < L->config.victim_lines; j++)
+            L->victims[j].valid = 0;
+        if (L->strides != NULL)
+            memset(L->strides, 0, STRIDE_ENTRIES * sizeof(stride_entry_t));
+        L->clock = 0;
+        L->stats = (cache_stats_t) { 0 };
+        if (L->classifier != NULL)
+            classifier_reset(L->classifier);
+    }
+    sim->rand_state = RAND_SEED;
+    sim->pc = 0;
+}
+
+/*
+ * touch - Tell the replacement policy that way was just used (filled is
+ *     set when the line was just brought in)
+ */
+static void touch(cache_level_t* L, unsigned long long set_index,
+                  unsigned int way, int filled) {
+    cache_line_t* line = &L->lines[set_index * L->config.E + way];
+    unsigned char* bits;
+    unsigned int node;
+
+    switch (L->config.policy) {
+    case CACHESIM_LRU:
+        line->stamp = L->clock;
+        break;
+    case CACHESIM_FIFO:
+        if (filled)
+            line->stamp = L->clock;
+        break;
+    case CACHESIM_RANDOM:
+        break;
+    case CACHESIM_PLRU:
+        /* Point every node on the path to way at the other subtree */
+        if (L->config.E == 1)
+            break;
+        bits = &L->plru[set_index * L->config.E];
+        node = way + L->config.E - 1;
+        while (node > 0) {
+            unsigned int parent = (node - 1) / 2;
+            bits[parent] = (node == 2 * parent + 1);
+            node = parent;
+        }
+        break;
+    }
+}
+
+/*
+ * choose_way - Pick the way a new block replaces: an invalid line if the
+ *     set has one, otherwise the policy's choice
+ */
+static unsigned int choose_way(cache_sim_t* sim, cache_level_t* L,
+                               unsigned long long set_index) {
+    cache_line_t* set = &L->lines[set_index * L->config.E];
+    unsigned int E = L->config.E;
+    unsigned int i, way = 0;
+    unsigned char* bits;
+    unsigned int node;
+
+    for (i = 0; i < E; i++)
+        if (!set[i].valid)
+            return i;
+
+    switch (L->config.policy) {
+    case CACHESIM_LRU:
+    case CACHESIM_FIFO:
+        for (i = 1; i < E; i++)
+            if (set[i].stamp < set[way].stamp)
+                way = i;
+        break;
+    case CACHESIM_RANDOM:
+        sim->rand_state ^= sim->rand_state << 13;
+        sim->rand_state ^= sim->rand_state >> 7;
+        sim->rand_state ^= sim->rand_state << 17;
+        way = sim->rand_state % E;
+        break;
+    case CACHESIM_PLRU:
+        if (E == 1)
+            break;
+        bits = &L->plru[set_index * E];
+        node = 0;
+        while (node < E - 1)
+            node = 2 * node + 1 + bits[node];
+        way = node - (E - 1);
+        break;
+    }
+    return way;
+}
+
+/*
+ * write_back - Send a dirty line leaving level lvl to the next level
+ */
+static void write_back(cache_sim_t* sim, int lvl, const cache_line_t* line) {
+    cache_level_t* L = &sim->levels[lvl];
+
+    L->stats.writebacks++;
+    if (lvl + 1 < sim->num_levels)
+        level_access(sim, lvl + 1, line->block << L->config.b,
+                     1U << L->config.b, 1, 0);
+}
+
+/*
+ * victim_insert - Move a line displaced from the sets into the victim
+ *     buffer, pushing out its least recently used entry if it is full
+ */
+static void victim_insert(cache_sim_t* sim, int lvl, const cache_line_t* line) {
+    cache_level_t* L = &sim->levels[lvl];
+    cache_line_t* slot = &L->victims[0];
+    unsigned int i;
+
+    for (i = 0; i < L->config.victim_lines; i++) {
+        if (!L->victims[i].valid) {
+            slot = &L->victims[i];
+            break;
+        }
+        if (L->victims[i].stamp < slot->stamp)
+            slot = &L->victims[i];
+    }
+    if (slot->valid && slot->dirty)
+        write_back(sim, lvl, slot);
+    *slot = *line;
+    slot->stamp = L->clock;
+}
+
+/*
+ * fill_block - Bring block into its set at level lvl, from the victim
+ *     buffer entry found if there is one, displacing a line chosen by the
+ *     replacement policy
+ */
+static void fill_block(cache_sim_t* sim, int lvl, unsigned long long block,
+                       cache_line_t* found, int is_store, int prefetched) {
+    cache_level_t* L = &sim->levels[lvl];
+    unsigned long long set_index = block & ((1ULL << L->config.s) - 1);
+    cache_line_t* set = &L->lines[set_index * L->config.E];
+    unsigned int way = choose_way(sim, L, set_index);
+    cache_line_t old = set[way];
+
+    if (found != NULL) {
+        set[way] = *found;
+        found->valid = 0;
+    } else {
+        set[way].valid = 1;
+        set[way].dirty = 0;
+        set[way].block = block;
+        set[way].prefetched = prefetched;
+    }
+    set[way].dirty |= is_store;
+    touch(L, set_index, way, 1);
+
+    if (old.valid) {
+        L->stats.evictions++;
+        if (L->victims != NULL)
+            victim_insert(sim, lvl, &old);
+        else if (old.dirty)
+            write_back(sim, lvl, &old);
+    }
+}
+
+/*
+ * find_block - The line holding block at level lvl, in its set or the
+ *     victim buffer (*in_victims says which), or NULL
+ */
+static cache_line_t* find_block(cache_level_t* L, unsigned long long block,
+                                int* in_victims) {
+    unsigned long long set_index = block & ((1ULL << L->config.s) - 1);
+    cache_line_t* set = &L->lines[set_index * L->config.E];
+    unsigned int i;
+
+    *in_victims = 0;
+    for (i = 0; i < L->config.E; i++)
+        if (set[i].valid && set[i].block == block)
+            return &set[i];
+    *in_victims = 1;
+    for (i = 0; i < L->config.victim_lines; i++)
+        if (L->victims[i].valid && L->victims[i].block == block)
+            return &L->victims[i];
+    return NULL;
+}
+
+/*
+ * prefetch_block - Bring block into level lvl ahead of demand, unless it
+ *     is already there
+ */
+static void prefetch_block(cache_sim_t* sim, int lvl, unsigned long long block) {
+    cache_level_t* L = &sim->levels[lvl];
+    int in_victims;
+
+    if (find_block(L, block, &in_victims) != NULL)
+        return;
+    L->clock++;
+    L->stats.prefetches++;
+    if (lvl + 1 < sim->num_levels)
+        level_access(sim, lvl + 1, block << L->config.b, 1U << L->config.b, 0, 0);
+    fill_block(sim, lvl, block, NULL, 0, 1);
+}
+
+/*
+ * stride_train - Record a demand access to block in the stride table.
+ *     Returns the block to prefetch, or block itself if there is none.
+ */
+static unsigned long long stride_train(cache_sim_t* sim, cache_level_t* L,
+                                       unsigned long long block) {
+    stride_entry_t* e = &L->strides[sim->pc & (STRIDE_ENTRIES - 1)];
+    long long stride = (long long) (block - e->last);
+
+    if (e->pc != sim->pc || e->last == 0) {
+        *e = (stride_entry_t) { sim->pc, block, 0, 0 };
+        return block;
+    }
+    /* Several accesses to one block say nothing about the stride */
+    if (stride == 0)
+        return block;
+    if (stride == e->stride) {
+        if (e->confidence < STRIDE_CONFIDENCE)
+            e->confidence++;
+    } else {
+        e->stride = stride;
+        e->confidence = 0;
+    }
+    e->last = block;
+    return e->confidence >= STRIDE_CONFIDENCE ? block + stride : block;
+}
+
+/*
+ * access_block - Look up one block at level lvl. A miss checks the victim
+ *     buffer, then fetches the block from the next level and fills it.
+ *     Demand accesses then give the level's prefetcher its chance.
+ */
+static void access_block(cache_sim_t* sim, int lvl, unsigned long long block,
+                         int is_store, int demand) {
+    cache_level_t* L = &sim->levels[lvl];
+    cache_line_t* found;
+    int seen = 0, shadow_hit = 0, in_victims, was_prefetched = 0;
+    unsigned long long target;
+
+    L->clock++;
+    if (L->classifier != NULL) {
+        seen = seen_insert(L->classifier, block);
+        shadow_hit = shadow_access(L->classifier, block);
+    }
+    found = find_block(L, block, &in_victims);
+    if (found != NULL) {
+        L->stats.hits++;
+        was_prefetched = found->prefetched;
+        if (found->prefetched && demand) {
+            L->stats.prefetch_hits++;
+            found->prefetched = 0;
+        }
+    }
+
+    if (found != NULL && !in_victims) {
+        unsigned long long set_index = block & ((1ULL << L->config.s) - 1);
+        found->dirty |= is_store;
+        touch(L, set_index, (unsigned int) (found - &L->lines[set_index * L->config.E]), 0);
+    } else {
+        if (found != NULL) {
+            L->stats.victim_hits++;
+        } else {
+            L->stats.misses++;
+            if (L->classifier != NULL) {
+                if (!seen)
+                    L->stats.compulsory++;
+                else if (!shadow_hit)
+                    L->stats.capacity++;
+                else
+                    L->stats.conflict++;
+            }
+            if (lvl + 1 < sim->num_levels)
+                level_access(sim, lvl + 1, block << L->config.b,
+                             1U << L->config.b, 0, demand);
+        }
+        /* Fill the block, swapping with the victim buffer entry on a hit there */
+        fill_block(sim, lvl, block, found, is_store, 0);
+    }
+
+    if (!demand)
+        return;
+    switch (L->config.prefetch) {
+    case CACHESIM_PREFETCH_NONE:
+        break;
+    case CACHESIM_PREFETCH_NEXT_LINE:
+        if (found == NULL || was_prefetched)
+            prefetch_block(sim, lvl, block + 1);
+        break;
+    case CACHESIM_PREFETCH_STRIDE:
+        target = stride_train(sim, L, block);
+        if (target != block)
+            prefetch_block(sim, lvl, target);
+        break;
+    }
+}
+
+/*
+ * level_access - Access len bytes at addr in level lvl, one lookup per
+ *     block touched
+ */
+static void level_access(cache_sim_t* sim, int lvl, unsigned long long addr,
+                         unsigned int len, int is_store, int demand) {
+    unsigned int b = sim->levels[lvl].config.b;
+    unsigned long long block = addr >> b;
+    unsigned long long last = (addr + (len ? len : 1) - 1) >> b;
+
+    for (; block <= last; block++)
+        access_block(sim, lvl, block, is_store, demand);
+}
+
+/*
+ * cachesim_access - Load or store len bytes at addr through the hierarchy
+ */
+void cachesim_access(cache_sim_t* sim, unsigned long long addr,
+                     unsigned int len, int is_store) {
+    level_access(sim, 0, addr, len, is_store, 1);
+}
+
+/*
+ * cachesim_set_pc - Attribute the accesses that follow to instruction pc
+ */
+void cachesim_set_pc(cache_sim_t* sim, unsigned long long pc) {
+    sim->pc = pc;
+}
+
+/*
+ * cachesim_parse_prefetch - Map a prefetcher name to its cache_prefetch_t
+ */
+int cachesim_parse_prefetch(const char* name) {
+    if (strcmp(name, "none") == 0)
+        return CACHESIM_PREFETCH_NONE;
+    if (strcmp(name, "next") == 0)
+        return CACHESIM_PREFETCH_NEXT_LINE;
+    if (strcmp(name, "stride") == 0)
+        return CACHESIM_PREFETCH_STRIDE;
+    return -1;
+}
+
+/*
+ * cachesim_results - Report the L1 hit, miss and eviction counts
+ */
+void cachesim_results(cache_sim_t* sim, unsigned int* hits,
+                      unsigned int* misses, unsigned int* evictions) {
+    *hits = sim->levels[0].stats.hits;
+    *misses = sim->levels[0].stats.misses;
+    *evictions = sim->levels[0].stats.evictions;
+}
+
+/*
+ * cachesim_num_levels - Report the number of levels in the hierarchy
+ */
+int cachesim_num_levels(cache_sim_t* sim) {
+    return sim->num_levels;
+}
+
+/*
+ * cachesim_stats - Report every counter of one level
+ */
+void cachesim_stats(cache_sim_t* sim, int level, cache_stats_t* stats) {
+    *stats = sim->levels[level].stats;
+}
+
+/*
+ * cachesim_print_counts - Print the hits, misses and miss classes in counts
+ */
+void cachesim_print_counts(const char* label, const cache_stats_t* counts) {
+    printf("%s: hits:%llu misses:%llu compulsory:%llu capacity:%llu conflict:%llu\n",
+           label, counts->hits, counts->misses, counts->compulsory,
+           counts->capacity, counts->conflict);
+}
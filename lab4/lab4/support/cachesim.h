@@ -0,0 +1,114 @@
+/*
+ * cachesim.h - An in-process cache simulator library. Each level is
+ *     parameterized like csim-ref by s (2^s sets), E (lines per set) and
+ *     b (2^b bytes per block), plus a replacement policy, an optional
+ *     fully-associative victim buffer and an optional hardware prefetcher.
+ *     Up to CACHESIM_MAX_LEVELS levels can be chained (L1 -> L2 -> L3).
+ *     Every level is write-back and write-allocate.
+ */
+
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#define CACHESIM_MAX_LEVELS 3
+
+typedef struct cache_sim cache_sim_t;
+
+typedef enum cache_policy {
+    CACHESIM_LRU,       /* least recently used */
+    CACHESIM_FIFO,      /* oldest fill */
+    CACHESIM_RANDOM,    /* uniformly random way (fixed seed, reproducible) */
+    CACHESIM_PLRU       /* tree pseudo-LRU; E must be a power of two */
+} cache_policy_t;
+
+typedef enum cache_prefetch {
+    CACHESIM_PREFETCH_NONE,
+    CACHESIM_PREFETCH_NEXT_LINE, /* tagged: a miss, or the first hit on a
+                                    prefetched block, fetches the next block */
+    CACHESIM_PREFETCH_STRIDE     /* per-instruction stride table, keyed on
+                                    the pc given to cachesim_set_pc() */
+} cache_prefetch_t;
+
+typedef struct cache_config {
+    unsigned int s;
+    unsigned int E;
+    unsigned int b;
+    cache_policy_t policy;
+    unsigned int victim_lines;      /* victim buffer entries, 0 for none */
+    cache_prefetch_t prefetch;
+} cache_config_t;
+
+typedef struct cache_stats {
+    unsigned long long hits;        /* includes victim buffer hits */
+    unsigned long long misses;
+    unsigned long long evictions;   /* valid lines displaced from the sets */
+    unsigned long long writebacks;  /* dirty lines written to the next level */
+    unsigned long long victim_hits;
+    unsigned long long prefetches;  /* blocks the prefetcher brought in */
+    unsigned long long prefetch_hits; /* first hits on those blocks */
+
+    /* The 3C miss classes, counted once cachesim_classify_misses() is on */
+    unsigned long long compulsory;  /* first access to the block */
+    unsigned long long capacity;    /* would also miss if fully associative LRU */
+    unsigned long long conflict;    /* the remaining misses */
+} cache_stats_t;
+
+/* Create an empty single-level LRU cache with 2^s sets of E lines of 2^b bytes */
+cache_sim_t* cachesim_create(unsigned int s, unsigned int E, unsigned int b);
+
+/*
+ * Create an empty hierarchy from num_levels configs, levels[0] being closest
+ * to the CPU. Returns NULL if a config is invalid or memory runs out.
+ */
+cache_sim_t* cachesim_create_hierarchy(const cache_config_t* levels,
+                                       int num_levels);
+
+/* Free a cache created by cachesim_create() or cachesim_create_hierarchy() */
+void cachesim_free(cache_sim_t* sim);
+
+/* Empty every level and zero its counters */
+void cachesim_reset(cache_sim_t* sim);
+
+/*
+ * Load (is_store == 0) or store len bytes at addr. Each L1 block the access
+ * touches counts as a hit or a miss (and possibly an eviction), like one
+ * load or store in csim-ref. Misses and writebacks go on to the next level.
+ */
+void cachesim_access(cache_sim_t* sim, unsigned long long addr,
+                     unsigned int len, int is_store);
+
+/*
+ * Name the instruction making the accesses that follow, for the stride
+ * prefetcher. Until it is called every access looks like it comes from the
+ * same instruction, which only suits traces with a single stream.
+ */
+void cachesim_set_pc(cache_sim_t* sim, unsigned long long pc);
+
+/* "none", "next" or "stride" to a cache_prefetch_t; returns -1 for others */
+int cachesim_parse_prefetch(const char* name);
+
+/* Read the L1 counters accumulated since the cache was created or reset */
+void cachesim_results(cache_sim_t* sim, unsigned int* hits,
+                      unsigned int* misses, unsigned int* evictions);
+
+/* Number of levels in the hierarchy */
+int cachesim_num_levels(cache_sim_t* sim);
+
+/* Read every counter of one level (0 is L1) */
+void cachesim_stats(cache_sim_t* sim, int level, cache_stats_t* stats);
+
+/*
+ * Start sorting each level's misses into compulsory, capacity and conflict
+ * misses. Every level then also keeps the set of blocks it has seen and a
+ * fully-associative LRU cache of the same size to compare against, so this
+ * costs memory and time. Returns 0 if memory runs out.
+ */
+int cachesim_classify_misses(cache_sim_t* sim);
+
+/*
+ * Print "<label>: hits:H misses:M compulsory:C capacity:P conflict:F",
+ * the format csim -A and test-trans -A report attributions in
+ */
+void cachesim_print_counts(const char* label, const cache_stats_t* counts);
+
+#endif /* CACHESIM_H */
@@ -0,0 +1,93 @@
+/*
+ * chase.c - The pointer chasing in chase.h
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "clock.h"
+#include "chase.h"
+
+/* Timed runs per chase_cycles(), of which the fastest counts */
+#define CHASE_TRIALS 3
+
+/* Where the last chase ended, so the compiler cannot drop the loads */
+static void* volatile chase_sink;
+
+/*
+ * chase_alloc - Allocate and fault in a chase buffer
+ */
+char* chase_alloc(size_t size, int huge) {
+    char* base;
+
+    size = (size + CHASE_HUGE_PAGE - 1) & ~(CHASE_HUGE_PAGE - 1);
+    base = aligned_alloc(CHASE_HUGE_PAGE, size);
+    if (base == NULL) {
+        fprintf(stderr, "chase: unable to allocate %zu bytes\n", size);
+        exit(1);
+    }
+    /* Only advice: without transparent huge pages it has no effect */
+    madvise(base, size, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    memset(base, 0, size);
+    return base;
+}
+
+/*
+ * chase_shuffle - Fisher-Yates, on a splitmix64 stream
+ */
+void chase_shuffle(size_t* offsets, size_t n, unsigned long long seed) {
+    unsigned long long z;
+    size_t i, j, tmp;
+
+    for (i = n; i > 1; i--) {
+        z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        j = (size_t) (z % i);
+        tmp = offsets[i - 1];
+        offsets[i - 1] = offsets[j];
+        offsets[j] = tmp;
+    }
+}
+
+/*
+ * chase_link - Point each slot at the next, and the last at the first
+ */
+void chase_link(char* base, const size_t* offsets, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        *(void**) (base + offsets[i]) = base + offsets[(i + 1) % n];
+}
+
+/*
+ * follow - Take `loads` steps along a chain from p
+ */
+static void* follow(void* p, long loads) {
+    long i;
+
+    for (i = 0; i < loads; i++)
+        p = *(void**) p;
+    return p;
+}
+
+/*
+ * chase_cycles - Best cycles per load over CHASE_TRIALS timed runs
+ */
+double chase_cycles(char* base, size_t first, long loads) {
+    void* p = follow(base + first, loads);
+    double cycles, best = 0;
+    int trial;
+
+    for (trial = 0; trial < CHASE_TRIALS; trial++) {
+        start_counter();
+        p = follow(p, loads);
+        cycles = get_counter() / loads;
+        if (trial == 0 || cycles < best)
+            best = cycles;
+    }
+    chase_sink = p;
+    return best;
+}
@@ -0,0 +1,39 @@
+/*
+ * chase.h - Pointer chasing for measuring load latency on real hardware.
+ *     Each slot of a chain holds the address of the next one, so every
+ *     load depends on the one before it and none can overlap or be
+ *     prefetched ahead; cycles per load is then the latency of wherever
+ *     the chain lives, timed with clock.c's cycle counter.
+ */
+
+#ifndef CHASE_H
+#define CHASE_H
+
+#include <stddef.h>
+
+/* Page sizes a chase buffer can be backed with */
+#define CHASE_SMALL_PAGE (4UL << 10)
+#define CHASE_HUGE_PAGE (2UL << 20)
+
+/*
+ * Allocate size bytes aligned to a huge page and fault them all in. With
+ * huge set the kernel is asked for 2 MiB pages, so offsets below 2 MiB
+ * are physical too and the TLB stays out of the way; otherwise for 4 KiB
+ * pages. Exits if the memory is not available.
+ */
+char* chase_alloc(size_t size, int huge);
+
+/* Shuffle offsets[0..n) uniformly, from a generator seeded with seed */
+void chase_shuffle(size_t* offsets, size_t n, unsigned long long seed);
+
+/* Link base + offsets[0], ..., base + offsets[n - 1] into a cycle */
+void chase_link(char* base, const size_t* offsets, size_t n);
+
+/*
+ * Follow the cycle from base + first for `loads` loads as a warm-up, then
+ * time the same number again, a few times over. Returns the fewest cycles
+ * per load seen, which discounts interrupts and other noise.
+ */
+double chase_cycles(char* base, size_t first, long loads);
+
+#endif /* CHASE_H */
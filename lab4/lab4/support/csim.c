@@ -0,0 +1,431 @@
+/*
+ * csim.c - A source-level replacement for csim-ref, built on the cachesim
+ *     library. It replays a valgrind lackey trace, or a binary trace from
+ *     tracegen -B or test-trans -L (see bintrace.h), through a cache with the
+ *     given geometry and reports the L1 hits, misses and evictions through
+ *     printSummary(), exactly like csim-ref. Extra options select the
+ *     replacement policy, a victim buffer, a prefetcher, and L2/L3 levels.
+ *
+ * Accesses in a binary trace from tracegen -B count every block they span,
+ * as in the in-process model test-trans uses, so a 32-byte AVX2 load that
+ * straddles two blocks is two accesses. Text lackey traces, and the binary
+ * traces test-trans -L converts from them (flagged BINTRACE_FIRST_BYTE),
+ * keep csim-ref's rule that an access only touches the block holding its
+ * first byte, so they are counted exactly as csim-ref counts them.
+ *
+ * With -A it also breaks the L1 misses down into compulsory, capacity and
+ * conflict misses, by the address ranges given with -r (e.g. the matrices
+ * A and B), and by the instruction from the trace's "I" records.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "cachesim.h"
+#include "bintrace.h"
+
+#define MAX_REGIONS 8
+
+/* Instructions reported with -A */
+#define TOP_SITES 10
+
+/* An address range named with -r */
+typedef struct region {
+    char name[32];
+    unsigned long long lo, hi;      /* [lo, hi) */
+    cache_stats_t counts;
+} region_t;
+
+/* The L1 counts charged to one instruction */
+typedef struct site {
+    unsigned long long pc;
+    cache_stats_t counts;
+} site_t;
+
+static int attribute = 0;           /* -A */
+static region_t regions[MAX_REGIONS];
+static int num_regions = 0;
+static site_t* sites = NULL;        /* open-addressed by pc + 1 */
+static size_t sites_size = 0, num_sites = 0;
+static unsigned long long current_pc = 0;
+
+/*
+ * parse_policy - Map a policy name to its cache_policy_t, exiting if it is
+ *     not one we know
+ */
+static cache_policy_t parse_policy(const char* name) {
+    if (strcmp(name, "lru") == 0)
+        return CACHESIM_LRU;
+    if (strcmp(name, "fifo") == 0)
+        return CACHESIM_FIFO;
+    if (strcmp(name, "random") == 0)
+        return CACHESIM_RANDOM;
+    if (strcmp(name, "plru") == 0)
+        return CACHESIM_PLRU;
+    fprintf(stderr, "Unknown replacement policy '%s'\n", name);
+    exit(1);
+}
+
+/*
+ * parse_prefetch - Map a prefetcher name to its cache_prefetch_t, exiting
+ *     if it is not one we know
+ */
+static cache_prefetch_t parse_prefetch(const char* name) {
+    int prefetch = cachesim_parse_prefetch(name);
+
+    if (prefetch < 0) {
+        fprintf(stderr, "Unknown prefetcher '%s'\n", name);
+        exit(1);
+    }
+    return (cache_prefetch_t) prefetch;
+}
+
+/*
+ * parse_level - Parse "s,E,b[,policy[,victim_lines[,prefetcher]]]" into config
+ */
+static void parse_level(const char* arg, cache_config_t* config) {
+    char policy[16] = "lru", prefetch[16] = "none";
+    int n = sscanf(arg, "%u,%u,%u,%15[a-z],%u,%15[a-z]", &config->s, &config->E,
+                   &config->b, policy, &config->victim_lines, prefetch);
+    if (n < 3) {
+        fprintf(stderr, "Bad level '%s', expected s,E,b[,policy[,victims[,prefetcher]]]\n",
+                arg);
+        exit(1);
+    }
+    if (n < 5)
+        config->victim_lines = 0;
+    config->policy = parse_policy(policy);
+    config->prefetch = parse_prefetch(prefetch);
+}
+
+/*
+ * parse_region - Parse "name:lo:hi", with lo and hi in hex, into a region
+ */
+static void parse_region(const char* arg) {
+    region_t* r = &regions[num_regions];
+
+    if (num_regions == MAX_REGIONS
+        || sscanf(arg, "%31[^:]:%llx:%llx", r->name, &r->lo, &r->hi) != 3) {
+        fprintf(stderr, "Bad region '%s', expected name:lo:hi (at most %d)\n",
+                arg, MAX_REGIONS);
+        exit(1);
+    }
+    num_regions++;
+}
+
+/*
+ * find_site - The counts for instruction pc, growing the table as needed
+ */
+static site_t* find_site(unsigned long long pc) {
+    size_t i;
+
+    if (2 * (num_sites + 1) > sites_size) {
+        site_t* old = sites;
+        size_t old_size = sites_size;
+
+        sites_size = old_size ? 2 * old_size : 1024;
+        sites = calloc(sites_size, sizeof(site_t));
+        if (sites == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        num_sites = 0;
+        for (i = 0; i < old_size; i++)
+            if (old[i].pc != 0)
+                *find_site(old[i].pc - 1) = old[i];
+        free(old);
+    }
+
+    i = (size_t) ((pc * 0x9e3779b97f4a7c15ULL) >> 20) & (sites_size - 1);
+    while (sites[i].pc != 0 && sites[i].pc != pc + 1)
+        i = (i + 1) & (sites_size - 1);
+    if (sites[i].pc == 0) {
+        sites[i].pc = pc + 1;
+        num_sites++;
+    }
+    return &sites[i];
+}
+
+/*
+ * add_counts - Add the change from before to after to *total
+ */
+static void add_counts(cache_stats_t* total, const cache_stats_t* before,
+                       const cache_stats_t* after) {
+    total->hits += after->hits - before->hits;
+    total->misses += after->misses - before->misses;
+    total->evictions += after->evictions - before->evictions;
+    total->compulsory += after->compulsory - before->compulsory;
+    total->capacity += after->capacity - before->capacity;
+    total->conflict += after->conflict - before->conflict;
+}
+
+/*
+ * compare_sites - Order sites by misses, most first, then by address
+ */
+static int compare_sites(const void* a, const void* b) {
+    const site_t* x = a;
+    const site_t* y = b;
+
+    if (x->counts.misses != y->counts.misses)
+        return x->counts.misses < y->counts.misses ? 1 : -1;
+    return x->pc < y->pc ? -1 : x->pc > y->pc;
+}
+
+/*
+ * print_attribution - Report the L1 counts by class, region and instruction
+ */
+static void print_attribution(cache_sim_t* sim) {
+    cache_stats_t total;
+    char label[64];
+    size_t i, n = 0;
+
+    cachesim_stats(sim, 0, &total);
+    cachesim_print_counts("all", &total);
+    for (i = 0; i < (size_t) num_regions; i++)
+        cachesim_print_counts(regions[i].name, &regions[i].counts);
+
+    /* Compact the table, then sort what is left */
+    for (i = 0; i < sites_size; i++)
+        if (sites[i].pc != 0)
+            sites[n++] = sites[i];
+    qsort(sites, n, sizeof(site_t), compare_sites);
+    for (i = 0; i < n && i < TOP_SITES; i++) {
+        if (sites[i].pc == 1)
+            continue;       /* accesses before the first "I" record */
+        sprintf(label, "pc %llx", sites[i].pc - 1);
+        cachesim_print_counts(label, &sites[i].counts);
+    }
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[]) {
+    printf("Usage: %s [-hvA] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+    printf("          [-p <policy>] [-V <num>] [-f <prefetcher>] [-2 <level>] [-3 <level>]\n");
+    printf("          [-r <name>:<lo>:<hi>]...\n");
+    printf("Options:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -v         Optional verbose flag.\n");
+    printf("  -s <num>   Number of set index bits.\n");
+    printf("  -E <num>   Number of lines per set.\n");
+    printf("  -b <num>   Number of block offset bits.\n");
+    printf("  -t <file>  Trace file.\n");
+    printf("  -p <name>  L1 replacement policy: lru (default), fifo, random, plru.\n");
+    printf("  -V <num>   Number of L1 victim buffer entries (default 0).\n");
+    printf("  -f <name>  L1 prefetcher: none (default), next, stride.\n");
+    printf("  -2 <level> Add an L2 given as s,E,b[,policy[,victims[,prefetcher]]].\n");
+    printf("  -3 <level> Add an L3 (requires -2), same format.\n");
+    printf("  -A         Attribute L1 misses to 3C classes, regions and instructions.\n");
+    printf("  -r <range> Name the hex address range [lo, hi) for -A.\n");
+    printf("\nExamples:\n");
+    printf("  linux>  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  linux>  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  linux>  %s -s 6 -E 8 -b 6 -p plru -2 10,16,6 -t traces/yi.trace\n", argv[0]);
+}
+
+/*
+ * replay - Feed one len-byte trace access to the simulator, printing the L1
+ *     outcome when verbose
+ */
+static void replay(cache_sim_t* sim, unsigned long long addr, unsigned int len,
+                   int is_store, int verbose) {
+    cache_stats_t before, after;
+    unsigned long long i;
+    int r;
+
+    cachesim_stats(sim, 0, &before);
+    cachesim_set_pc(sim, current_pc);
+    cachesim_access(sim, addr, len, is_store);
+    if (!verbose && !attribute)
+        return;
+    cachesim_stats(sim, 0, &after);
+    if (attribute) {
+        for (r = 0; r < num_regions; r++)
+            if (addr >= regions[r].lo && addr < regions[r].hi)
+                add_counts(&regions[r].counts, &before, &after);
+        add_counts(&find_site(current_pc)->counts, &before, &after);
+    }
+    if (!verbose)
+        return;
+    for (i = before.misses; i < after.misses; i++)
+        printf("miss ");
+    for (i = before.evictions; i < after.evictions; i++)
+        printf("eviction ");
+    for (i = before.hits; i < after.hits; i++)
+        printf("hit ");
+}
+
+int main(int argc, char* argv[]) {
+    cache_config_t levels[CACHESIM_MAX_LEVELS];
+    int num_levels = 1, have_l3 = 0;
+    int have_s = 0, have_E = 0, have_b = 0, verbose = 0;
+    char* trace_file = NULL;
+    char buf[1000];
+    char c;
+    FILE* trace_fp;
+    bintrace_t* bin_trace;
+    unsigned long long addr;
+    unsigned int len;
+    char op;
+    cache_sim_t* sim;
+    unsigned int hits, misses, evictions;
+    int i;
+
+    levels[0].policy = CACHESIM_LRU;
+    levels[0].victim_lines = 0;
+    levels[0].prefetch = CACHESIM_PREFETCH_NONE;
+
+    while ((c = getopt(argc, argv, "hvs:E:b:t:p:V:f:2:3:Ar:")) != -1) {
+        switch(c) {
+        case 'h':
+            usage(argv);
+            exit(0);
+        case 'v':
+            verbose = 1;
+            break;
+        case 's':
+            levels[0].s = atoi(optarg);
+            have_s = 1;
+            break;
+        case 'E':
+            levels[0].E = atoi(optarg);
+            have_E = 1;
+            break;
+        case 'b':
+            levels[0].b = atoi(optarg);
+            have_b = 1;
+            break;
+        case 't':
+            trace_file = optarg;
+            break;
+        case 'p':
+            levels[0].policy = parse_policy(optarg);
+            break;
+        case 'V':
+            levels[0].victim_lines = atoi(optarg);
+            break;
+        case 'f':
+            levels[0].prefetch = parse_prefetch(optarg);
+            break;
+        case '2':
+            parse_level(optarg, &levels[1]);
+            num_levels = 2;
+            break;
+        case '3':
+            parse_level(optarg, &levels[2]);
+            have_l3 = 1;
+            break;
+        case 'A':
+            attribute = 1;
+            break;
+        case 'r':
+            parse_region(optarg);
+            break;
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (!have_s || !have_E || !have_b || trace_file == NULL) {
+        printf("%s: Missing required command line argument\n", argv[0]);
+        usage(argv);
+        exit(1);
+    }
+    if (have_l3) {
+        if (num_levels != 2) {
+            printf("%s: -3 requires -2\n", argv[0]);
+            exit(1);
+        }
+        num_levels = 3;
+    }
+
+    sim = cachesim_create_hierarchy(levels, num_levels);
+    if (sim == NULL) {
+        printf("%s: Invalid cache geometry\n", argv[0]);
+        exit(1);
+    }
+    if (attribute && !cachesim_classify_misses(sim)) {
+        printf("%s: Out of memory\n", argv[0]);
+        exit(1);
+    }
+
+    bin_trace = bintrace_open_read(trace_file);
+    if (bin_trace != NULL) {
+        while (bintrace_read(bin_trace, &op, &addr, &len)) {
+            if (op == 'I') {
+                current_pc = addr;
+                continue;
+            }
+            if (verbose)
+                printf("%c %llx,%u ", op, addr, len);
+            if (bin_trace->flags & BINTRACE_FIRST_BYTE)
+                len = 1;
+            replay(sim, addr, len, op == 'S', verbose);
+            if (op == 'M')
+                replay(sim, addr, len, 1, verbose);
+            if (verbose)
+                printf("\n");
+        }
+        bintrace_close(bin_trace);
+    } else {
+        trace_fp = fopen(trace_file, "r");
+        if (trace_fp == NULL) {
+            printf("%s: Could not open %s\n", argv[0], trace_file);
+            exit(1);
+        }
+
+        /* Lackey lines look like " L 04f6b868,8"; instruction fetches
+           ("I  0400d7d4,8") only set the instruction for -A */
+        while (fgets(buf, sizeof(buf), trace_fp) != NULL) {
+            if (buf[0] == 'I') {
+                if (sscanf(buf, "I %llx,%u", &addr, &len) == 2)
+                    current_pc = addr;
+                continue;
+            }
+            if (buf[0] != ' ' || sscanf(buf, " %c %llx,%u", &op, &addr, &len) != 3)
+                continue;
+            if (op != 'L' && op != 'S' && op != 'M')
+                continue;
+            if (verbose)
+                printf("%c %llx,%u ", op, addr, len);
+            /* Like csim-ref, only the block holding the first byte */
+            replay(sim, addr, 1, op == 'S', verbose);
+            if (op == 'M')
+                replay(sim, addr, 1, 1, verbose);
+            if (verbose)
+                printf("\n");
+        }
+        fclose(trace_fp);
+    }
+
+    for (i = 1; i < num_levels; i++) {
+        cache_stats_t stats;
+        cachesim_stats(sim, i, &stats);
+        printf("L%d hits:%llu misses:%llu evictions:%llu writebacks:%llu\n",
+               i + 1, stats.hits, stats.misses, stats.evictions, stats.writebacks);
+    }
+    if (levels[0].victim_lines > 0) {
+        cache_stats_t stats;
+        cachesim_stats(sim, 0, &stats);
+        printf("L1 victim buffer hits:%llu\n", stats.victim_hits);
+    }
+    for (i = 0; i < num_levels; i++) {
+        cache_stats_t stats;
+        if (levels[i].prefetch == CACHESIM_PREFETCH_NONE)
+            continue;
+        cachesim_stats(sim, i, &stats);
+        printf("L%d prefetches:%llu useful:%llu\n", i + 1, stats.prefetches,
+               stats.prefetch_hits);
+    }
+
+    if (attribute)
+        print_attribution(sim);
+
+    cachesim_results(sim, &hits, &misses, &evictions);
+    printSummary(hits, misses, evictions);
+    cachesim_free(sim);
+    return 0;
+}
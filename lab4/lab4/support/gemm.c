@@ -0,0 +1,74 @@
+/*
+ * gemm.c - Matrix multiply kernels
+ */
+#include "cachelab.h"
+#include "gemm.h"
+
+/* 8 ints is one 32-byte block, so a tile row is one block of each matrix */
+#define GEMM_TILE 8
+
+/*
+ * gemm_naive - One dot product per element of C
+ */
+char gemm_naive_desc[] = "Naive i-j-k matrix multiply";
+void gemm_naive(int M, int N, int A[M][N], int B[N][M], int C[M][M]) {
+    int i, j, k, sum;
+
+    for (i = 0; i < M; i++)
+        for (j = 0; j < M; j++) {
+            sum = 0;
+            for (k = 0; k < N; k++)
+                sum += A[i][k] * B[k][j];
+            C[i][j] = sum;
+        }
+}
+
+/*
+ * gemm_ikj - Add A[i][k] times row k of B into row i of C, so both rows
+ *     are read sequentially
+ */
+char gemm_ikj_desc[] = "Row-streaming i-k-j matrix multiply";
+void gemm_ikj(int M, int N, int A[M][N], int B[N][M], int C[M][M]) {
+    int i, j, k, a;
+
+    for (i = 0; i < M; i++) {
+        for (j = 0; j < M; j++)
+            C[i][j] = 0;
+        for (k = 0; k < N; k++) {
+            a = A[i][k];
+            for (j = 0; j < M; j++)
+                C[i][j] += a * B[k][j];
+        }
+    }
+}
+
+/*
+ * gemm_blocked - The i-k-j multiply over tiles, so the tiles of A, B and
+ *     C in use stay cached while each is reused GEMM_TILE times
+ */
+char gemm_blocked_desc[] = "Blocked 8x8 matrix multiply";
+void gemm_blocked(int M, int N, int A[M][N], int B[N][M], int C[M][M]) {
+    int ii, jj, kk, i, j, k, a;
+
+    for (i = 0; i < M; i++)
+        for (j = 0; j < M; j++)
+            C[i][j] = 0;
+    for (ii = 0; ii < M; ii += GEMM_TILE)
+        for (kk = 0; kk < N; kk += GEMM_TILE)
+            for (jj = 0; jj < M; jj += GEMM_TILE)
+                for (i = ii; i < ii + GEMM_TILE && i < M; i++)
+                    for (k = kk; k < kk + GEMM_TILE && k < N; k++) {
+                        a = A[i][k];
+                        for (j = jj; j < jj + GEMM_TILE && j < M; j++)
+                            C[i][j] += a * B[k][j];
+                    }
+}
+
+/*
+ * registerGemmFunctions - Register the three multiplies
+ */
+void registerGemmFunctions() {
+    registerGemmFunction(gemm_naive, gemm_naive_desc);
+    registerGemmFunction(gemm_ikj, gemm_ikj_desc);
+    registerGemmFunction(gemm_blocked, gemm_blocked_desc);
+}
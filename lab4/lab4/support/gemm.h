@@ -0,0 +1,22 @@
+/*
+ * gemm.h - Integer matrix multiplies C = A B, with A M x N, B N x M and
+ *     C M x M, in the three loop orders that matter for the cache: one dot
+ *     product per element, row-streaming, and tiled.
+ */
+
+#ifndef GEMM_H
+#define GEMM_H
+
+/* i-j-k order: the inner loop walks down a column of B */
+void gemm_naive(int M, int N, int A[M][N], int B[N][M], int C[M][M]);
+
+/* i-k-j order: the inner loop streams along rows of B and C */
+void gemm_ikj(int M, int N, int A[M][N], int B[N][M], int C[M][M]);
+
+/* i-k-j order over GEMM_TILE x GEMM_TILE tiles of all three matrices */
+void gemm_blocked(int M, int N, int A[M][N], int B[N][M], int C[M][M]);
+
+/* Register the multiplies above */
+void registerGemmFunctions();
+
+#endif /* GEMM_H */
@@ -0,0 +1,53 @@
+/*
+ * infer-cache.c - Prints the geometry and replacement policy of the cache
+ *     it is linked with, as inferred by cache-infer.c, and how many
+ *     access_cache() calls that took. The Makefile links it with the
+ *     cachesim backend (./infer-cache, configured by MYSTERY_CACHE) and the
+ *     hardware timing backend (./infer-cache-hw), or with any mystery cache
+ *     object via "make infer-cache-test TEST_CACHE=...".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include "mystery-cache.h"
+#include "cache-infer.h"
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[]) {
+    printf("Usage: %s [-h]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("Example: MYSTERY_CACHE=6,8,6,fifo,4 %s\n", argv[0]);
+}
+
+int main(int argc, char* argv[]) {
+    cache_geometry_t g;
+    char c;
+
+    while ((c = getopt(argc, argv, "h")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    cache_init(0, 0);
+    infer_geometry(&g);
+    if (g.cache_size < 0) {
+        printf("Unable to infer the cache geometry (block size %d)\n", g.block_size);
+        exit(1);
+    }
+    printf("Cache block size: %d bytes\n", g.block_size);
+    printf("Cache size: %d bytes\n", g.cache_size);
+    printf("Cache associativity: %d\n", g.assoc);
+    printf("Replacement policy: %s\n", infer_policy_name(g.policy));
+    printf("Victim buffer lines: %d\n", g.victim_lines);
+    printf("access_cache() calls: %llu\n", infer_calls());
+    return 0;
+}
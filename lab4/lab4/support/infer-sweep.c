@@ -0,0 +1,219 @@
+/*
+ * infer-sweep.c - Checks cache inference code against hundreds of
+ *     simulated cache geometries in one process, rather than relinking
+ *     cache-test against one object in caches/ at a time the way
+ *     testCache.sh does. Each geometry gets its own cache from the factory
+ *     in mystery-cache.h, selected on whichever thread-pool worker runs it,
+ *     so the inference code needs no changes to run in parallel.
+ *
+ * By default it checks get_block_size(), get_cache_size() and
+ * get_cache_assoc() from cache-test-skel.c, which the Makefile builds with
+ * its main() renamed; -r checks infer_geometry() from cache-infer.c
+ * instead. Either must keep its state in locals, or thread-local storage.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include "mystery-cache.h"
+#include "cache-infer.h"
+#include "threadpool.h"
+
+/* Bounds on the generated geometries; -m 1048576 takes in the largest
+   provided cache, cache_1048576c_256e_256k */
+#define DEFAULT_MAX_SIZE (1 << 16)
+#define MAX_ASSOC 256
+#define MAX_BLOCK_SIZE 256
+
+/* Most geometries in one sweep */
+#define MAX_GEOMETRIES 8192
+
+/* Failures printed before the rest are only counted */
+#define MAX_REPORTED 20
+
+/* The inference routines cache-test-skel.c leaves to the student */
+int get_block_size(void);
+int get_cache_size(int block_size);
+int get_cache_assoc(int cache_size);
+
+typedef struct sweep_case {
+    int size, assoc, block_size;        /* the cache: c, e and k */
+    int got_size, got_assoc, got_block_size;
+    unsigned long long calls;           /* access_cache() calls, with -r */
+    int invalid;                        /* cache_create() refused it */
+} sweep_case_t;
+
+static sweep_case_t cases[MAX_GEOMETRIES];
+static int reference = 0;
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[]) {
+    printf("Usage: %s [-hrv] [-j <n>] [-m <bytes>] [-c <c,e,k>]...\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -r          Check cache-infer.c rather than cache-test-skel.c.\n");
+    printf("  -v          Print every geometry, not just the failures.\n");
+    printf("  -j <n>      Worker threads (default: one per CPU).\n");
+    printf("  -m <bytes>  Largest cache generated (default %d).\n", DEFAULT_MAX_SIZE);
+    printf("  -c <c,e,k>  Check only this geometry, as in cache_<c>c_<e>e_<k>k.o;\n");
+    printf("              may be repeated.\n");
+    printf("Example: %s -r -j 8 -c 65536,2,16 -c 32768,8,8\n", argv[0]);
+}
+
+/*
+ * is_assoc - Associativities worth sweeping: powers of two and three times
+ *     a power of two, so some sets are not a power of two lines wide
+ */
+static int is_assoc(int n) {
+    while (n % 2 == 0)
+        n /= 2;
+    return n == 1 || n == 3;
+}
+
+/*
+ * generate - Fill cases with every block size, associativity and set count
+ *     (powers of two) up to max_size bytes. Returns how many there are.
+ */
+static int generate(int max_size) {
+    int block_size, assoc;
+    long sets;
+    int n = 0;
+
+    for (block_size = 1; block_size <= MAX_BLOCK_SIZE; block_size *= 2)
+        for (assoc = 1; assoc <= MAX_ASSOC; assoc++) {
+            if (!is_assoc(assoc))
+                continue;
+            for (sets = 1; sets * assoc * block_size <= max_size && n < MAX_GEOMETRIES;
+                 sets *= 2)
+                cases[n++] = (sweep_case_t) { (int) (sets * assoc * block_size), assoc,
+                                              block_size };
+        }
+    return n;
+}
+
+/*
+ * run_case - Infer one geometry on its own cache, on this thread
+ */
+static void run_case(void* arg) {
+    sweep_case_t* c = arg;
+    mystery_cache_t* cache = cache_create(c->size, c->assoc, c->block_size);
+    unsigned long long calls = infer_calls();
+    cache_geometry_t g;
+
+    if (cache == NULL) {
+        c->invalid = 1;
+        return;
+    }
+    cache_select(cache);
+    if (reference) {
+        infer_geometry(&g);
+        c->got_block_size = g.block_size;
+        c->got_size = g.cache_size;
+        c->got_assoc = g.assoc;
+        c->calls = infer_calls() - calls;
+    } else {
+        /* The same calls cache-test's main() makes */
+        c->got_block_size = get_block_size();
+        c->got_size = get_cache_size(c->got_block_size);
+        c->got_assoc = get_cache_assoc(c->got_size);
+    }
+    cache_select(NULL);
+    cache_destroy(cache);
+}
+
+int main(int argc, char* argv[]) {
+    int max_size = DEFAULT_MAX_SIZE, num_threads = 0, verbose = 0;
+    int num_cases = 0, i, passed = 0, failed = 0;
+    unsigned long long calls = 0;
+    tpool_group_t group = TPOOL_GROUP_INIT;
+    struct timespec start, end;
+    tpool_t* pool;
+    sweep_case_t* c;
+    char opt;
+
+    while ((opt = getopt(argc, argv, "hrvj:m:c:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage(argv);
+            exit(0);
+        case 'r':
+            reference = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'j':
+            num_threads = atoi(optarg);
+            break;
+        case 'm':
+            max_size = atoi(optarg);
+            break;
+        case 'c':
+            if (num_cases == MAX_GEOMETRIES)
+                break;
+            c = &cases[num_cases++];
+            if (sscanf(optarg, "%d,%d,%d", &c->size, &c->assoc, &c->block_size) != 3) {
+                usage(argv);
+                exit(1);
+            }
+            break;
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (num_cases == 0)
+        num_cases = generate(max_size);
+    if (num_threads <= 0)
+        num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads <= 0)
+        num_threads = 1;
+    pool = tpool_create(num_threads);
+    if (pool == NULL) {
+        printf("Unable to start %d threads\n", num_threads);
+        exit(1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < num_cases; i++)
+        tpool_spawn(pool, &group, run_case, &cases[i]);
+    tpool_wait(pool, &group);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    tpool_destroy(pool);
+
+    for (i = 0; i < num_cases; i++) {
+        c = &cases[i];
+        if (c->invalid) {
+            printf("cache_%dc_%de_%dk: not a valid geometry\n", c->size, c->assoc,
+                   c->block_size);
+            continue;
+        }
+        calls += c->calls;
+        if (c->got_block_size == c->block_size && c->got_size == c->size
+            && c->got_assoc == c->assoc) {
+            passed++;
+            if (verbose)
+                printf("cache_%dc_%de_%dk: ok\n", c->size, c->assoc, c->block_size);
+            continue;
+        }
+        if (verbose || failed < MAX_REPORTED)
+            printf("cache_%dc_%de_%dk: got block size %d, size %d, associativity %d\n",
+                   c->size, c->assoc, c->block_size, c->got_block_size, c->got_size,
+                   c->got_assoc);
+        else if (failed == MAX_REPORTED)
+            printf("... (-v lists every failure)\n");
+        failed++;
+    }
+
+    printf("%d of %d geometries inferred correctly by %s, on %d threads in %.2f s\n",
+           passed, passed + failed, reference ? "cache-infer.c" : "cache-test-skel.c",
+           num_threads,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    if (reference)
+        printf("access_cache() calls: %llu\n", calls);
+    return failed == 0 ? 0 : 1;
+}
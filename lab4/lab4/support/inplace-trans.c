@@ -0,0 +1,106 @@
+/*
+ * inplace-trans.c - In-place transposes. Only the accesses to B count: the
+ *     cycle bitmap lives outside the traced ranges.
+ */
+#include <stdlib.h>
+#include "cachelab.h"
+#include "inplace-trans.h"
+
+/* 8 ints is one 32-byte block, so a tile pair spans 16 blocks */
+#define SWAP_TILE 8
+
+/*
+ * transpose_inplace_blocked - Swap each tile above the diagonal with its
+ *     mirror below it, transposing both on the way, so every block of the
+ *     pair is loaded once per tile rather than once per element
+ */
+char transpose_inplace_blocked_desc[] = "In-place blocked diagonal swap transpose";
+void transpose_inplace_blocked(int M, int N, int A[M][N], int B[N][M]) {
+    int (*X)[N] = (int (*)[N]) B;
+    int ii, jj, i, j, tmp;
+
+    if (M != N) {
+        transpose_inplace_cycles(M, N, A, B);
+        return;
+    }
+    for (ii = 0; ii < N; ii += SWAP_TILE) {
+        /* The diagonal tile: swap its upper and lower triangles */
+        for (i = ii; i < ii + SWAP_TILE && i < N; i++)
+            for (j = i + 1; j < ii + SWAP_TILE && j < N; j++) {
+                tmp = X[i][j];
+                X[i][j] = X[j][i];
+                X[j][i] = tmp;
+            }
+        /* Every tile right of it, with its mirror below it */
+        for (jj = ii + SWAP_TILE; jj < N; jj += SWAP_TILE)
+            for (i = ii; i < ii + SWAP_TILE && i < N; i++)
+                for (j = jj; j < jj + SWAP_TILE && j < N; j++) {
+                    tmp = X[i][j];
+                    X[i][j] = X[j][i];
+                    X[j][i] = tmp;
+                }
+    }
+}
+
+/*
+ * transpose_inplace_cycles - Element k = i*N + j of the M x N matrix
+ *     belongs at j*M + i, which is k*M mod (M*N - 1) for every k except
+ *     the last, so the transpose is a permutation that splits into cycles.
+ *     Each cycle is walked once from its smallest index, carrying one
+ *     element forward at a time.
+ */
+char transpose_inplace_cycles_desc[] = "In-place cycle-following transpose";
+void transpose_inplace_cycles(int M, int N, int A[M][N], int B[N][M]) {
+    int* X = &B[0][0];
+    long size = (long) M * N;
+    unsigned char* moved;
+    long start, k;
+    int carry, tmp;
+
+    /* The first and last elements never move */
+    if (size < 3)
+        return;
+    moved = calloc((size + 7) / 8, 1);
+    if (moved == NULL) {
+        /* Fall back to repeatedly rotating each cycle into place, finding
+           leaders by checking that no smaller index is in the cycle */
+        for (start = 1; start < size - 1; start++) {
+            for (k = start * M % (size - 1); k > start; k = k * M % (size - 1))
+                ;
+            if (k < start)
+                continue;
+            carry = X[start];
+            k = start;
+            do {
+                k = k * M % (size - 1);
+                tmp = X[k];
+                X[k] = carry;
+                carry = tmp;
+            } while (k != start);
+        }
+        return;
+    }
+
+    for (start = 1; start < size - 1; start++) {
+        if (moved[start / 8] & (1 << (start % 8)))
+            continue;
+        carry = X[start];
+        k = start;
+        do {
+            k = k * M % (size - 1);
+            tmp = X[k];
+            X[k] = carry;
+            carry = tmp;
+            moved[k / 8] |= 1 << (k % 8);
+        } while (k != start);
+    }
+    free(moved);
+}
+
+/*
+ * registerInPlaceFunctions - Register both in-place transposes
+ */
+void registerInPlaceFunctions() {
+    registerInPlaceTransFunction(transpose_inplace_blocked, transpose_inplace_blocked_desc);
+    registerInPlaceTransFunction(transpose_inplace_cycles, transpose_inplace_cycles_desc);
+}
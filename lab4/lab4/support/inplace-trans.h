@@ -0,0 +1,26 @@
+/*
+ * inplace-trans.h - Transposes that work in a single buffer. They follow
+ *     the in-place convention of registerInPlaceTransFunction(): B holds
+ *     A's data as an M x N matrix on entry and its N x M transpose on
+ *     return, so no second matrix is needed.
+ */
+
+#ifndef INPLACE_TRANS_H
+#define INPLACE_TRANS_H
+
+/*
+ * Swap tiles across the diagonal of a square matrix, then transpose the
+ * diagonal tiles themselves. Falls back to cycle-following when M != N.
+ */
+void transpose_inplace_blocked(int M, int N, int A[M][N], int B[N][M]);
+
+/*
+ * Move every element along its permutation cycle, using a bitmap of one
+ * bit per element to skip cycles already moved. Works for any M x N.
+ */
+void transpose_inplace_cycles(int M, int N, int A[M][N], int B[N][M]);
+
+/* Register both transposes above as in-place functions */
+void registerInPlaceFunctions();
+
+#endif /* INPLACE_TRANS_H */
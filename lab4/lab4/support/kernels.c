@@ -0,0 +1,225 @@
+/*
+ * kernels.c - Operands, inputs, dispatch and reference checks for every
+ *     kind of registered function (see kernels.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cachelab.h"
+#include "kernels.h"
+
+/*
+ * kernel_kind_name - Name the kind of f
+ */
+const char* kernel_kind_name(const trans_func_t* f) {
+    switch (f->kind) {
+    case KERNEL_GEMM:
+        return "gemm";
+    case KERNEL_STENCIL:
+        return "stencil";
+    case KERNEL_MATVEC:
+        return "matvec";
+    default:
+        return "transpose";
+    }
+}
+
+/*
+ * kernel_operand_name - Name operand k of f
+ */
+const char* kernel_operand_name(const trans_func_t* f, int k) {
+    static const char* names[][KERNEL_OPERANDS] = {
+        [KERNEL_TRANSPOSE] = { "A", "B", NULL },
+        [KERNEL_GEMM] = { "A", "B", "C" },
+        [KERNEL_STENCIL] = { "A", "B", NULL },
+        [KERNEL_MATVEC] = { "A", "x", "y" },
+    };
+    return names[(int) f->kind][k];
+}
+
+/*
+ * kernel_operands - Size each operand of f, in ints
+ */
+void kernel_operands(const trans_func_t* f, int M, int N,
+                     size_t len[KERNEL_OPERANDS]) {
+    len[0] = (size_t) M * N;
+    len[1] = (size_t) M * N;
+    len[2] = 0;
+    switch (f->kind) {
+    case KERNEL_GEMM:
+        len[2] = (size_t) M * M;
+        break;
+    case KERNEL_MATVEC:
+        len[1] = N;
+        len[2] = M;
+        break;
+    }
+}
+
+/*
+ * kernel_buffer_sizes - The largest size of each operand over every kind
+ */
+void kernel_buffer_sizes(int M, int N, size_t len[KERNEL_OPERANDS]) {
+    len[0] = (size_t) M * N;
+    len[1] = (size_t) M * N;
+    len[2] = (size_t) M * (M > N ? M : N);
+}
+
+/*
+ * small_values - Bring n ints into [0, KERNEL_VALUE_RANGE)
+ */
+static void small_values(int* a, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        a[i] %= KERNEL_VALUE_RANGE;
+}
+
+/*
+ * kernel_init - Fill the inputs of f with random data
+ */
+void kernel_init(const trans_func_t* f, int M, int N, int* ops[KERNEL_OPERANDS]) {
+    size_t len[KERNEL_OPERANDS];
+
+    kernel_operands(f, M, N, len);
+    /* Fills both A and the N x M matrix in ops[1] */
+    initMatrix(M, N, (int (*)[N]) ops[0], (int (*)[M]) ops[1]);
+    switch (f->kind) {
+    case KERNEL_TRANSPOSE:
+        if (f->in_place)
+            memcpy(ops[1], ops[0], sizeof(int) * len[0]);
+        break;
+    case KERNEL_GEMM:
+    case KERNEL_MATVEC:
+        small_values(ops[0], len[0]);
+        small_values(ops[1], len[1]);
+        break;
+    case KERNEL_STENCIL:
+        small_values(ops[0], len[0]);
+        break;
+    }
+}
+
+/*
+ * kernel_run - Call f through the pointer for its kind
+ */
+void kernel_run(const trans_func_t* f, int M, int N, int* ops[KERNEL_OPERANDS]) {
+    switch (f->kind) {
+    case KERNEL_TRANSPOSE:
+        (*f->func_ptr)(M, N, (int (*)[N]) ops[0], (int (*)[M]) ops[1]);
+        break;
+    case KERNEL_GEMM:
+        (*f->gemm_ptr)(M, N, (int (*)[N]) ops[0], (int (*)[M]) ops[1],
+                       (int (*)[M]) ops[2]);
+        break;
+    case KERNEL_STENCIL:
+        (*f->stencil_ptr)(M, N, (int (*)[N]) ops[0], (int (*)[N]) ops[1]);
+        break;
+    case KERNEL_MATVEC:
+        (*f->matvec_ptr)(M, N, (int (*)[N]) ops[0], ops[1], ops[2]);
+        break;
+    }
+}
+
+/*
+ * correctGemm - Baseline C = A B, one dot product per element
+ */
+static void correctGemm(int M, int N, int A[M][N], int B[N][M], int C[M][M]) {
+    int i, j, k, sum;
+
+    for (i = 0; i < M; i++)
+        for (j = 0; j < M; j++) {
+            sum = 0;
+            for (k = 0; k < N; k++)
+                sum += A[i][k] * B[k][j];
+            C[i][j] = sum;
+        }
+}
+
+/*
+ * correctStencil - Baseline 5-point Jacobi sweep
+ */
+static void correctStencil(int M, int N, int A[M][N], int B[M][N]) {
+    int i, j;
+
+    for (i = 0; i < M; i++)
+        for (j = 0; j < N; j++) {
+            if (i == 0 || j == 0 || i == M - 1 || j == N - 1)
+                B[i][j] = A[i][j];
+            else
+                B[i][j] = (A[i][j] + A[i - 1][j] + A[i + 1][j]
+                           + A[i][j - 1] + A[i][j + 1]) / 5;
+        }
+}
+
+/*
+ * correctMatvec - Baseline y = A x
+ */
+static void correctMatvec(int M, int N, int A[M][N], int x[N], int y[M]) {
+    int i, j, sum;
+
+    for (i = 0; i < M; i++) {
+        sum = 0;
+        for (j = 0; j < N; j++)
+            sum += A[i][j] * x[j];
+        y[i] = sum;
+    }
+}
+
+/*
+ * kernel_check - Compare the output operand of f with the reference
+ */
+int kernel_check(const trans_func_t* f, int M, int N, int* ops[KERNEL_OPERANDS],
+                 kernel_mismatch_t* bad) {
+    size_t len[KERNEL_OPERANDS], i;
+    int out = f->kind == KERNEL_GEMM || f->kind == KERNEL_MATVEC ? 2 : 1;
+    int cols = f->kind == KERNEL_STENCIL ? N : M;
+    int* expected;
+
+    kernel_operands(f, M, N, len);
+    expected = malloc(sizeof(int) * len[out]);
+    if (expected == NULL) {
+        fprintf(stderr, "Unable to allocate the reference output\n");
+        exit(1);
+    }
+    switch (f->kind) {
+    case KERNEL_TRANSPOSE:
+        correctTrans(M, N, (int (*)[N]) ops[0], (int (*)[M]) expected);
+        break;
+    case KERNEL_GEMM:
+        correctGemm(M, N, (int (*)[N]) ops[0], (int (*)[M]) ops[1], (int (*)[M]) expected);
+        break;
+    case KERNEL_STENCIL:
+        correctStencil(M, N, (int (*)[N]) ops[0], (int (*)[N]) expected);
+        break;
+    case KERNEL_MATVEC:
+        correctMatvec(M, N, (int (*)[N]) ops[0], ops[1], expected);
+        break;
+    }
+
+    for (i = 0; i < len[out]; i++)
+        if (ops[out][i] != expected[i])
+            break;
+    if (i < len[out]) {
+        bad->expected = expected[i];
+        bad->got = ops[out][i];
+        if (f->kind == KERNEL_MATVEC)
+            snprintf(bad->where, sizeof(bad->where), "%c[%d]",
+                     *kernel_operand_name(f, out), (int) i);
+        else
+            snprintf(bad->where, sizeof(bad->where), "%c[%d][%d]",
+                     *kernel_operand_name(f, out), (int) (i / cols), (int) (i % cols));
+    }
+    free(expected);
+    return i == len[out];
+}
+
+/*
+ * kernel_bytes - Compulsory traffic of one run of f
+ */
+double kernel_bytes(const trans_func_t* f, int M, int N) {
+    size_t len[KERNEL_OPERANDS];
+
+    kernel_operands(f, M, N, len);
+    return (double) sizeof(int) * (len[0] + len[1] + len[2]);
+}
@@ -0,0 +1,72 @@
+/*
+ * kernels.h - What the harnesses need to know about each kind of
+ *     registered function (see KERNEL_* in cachelab.h): its operands, how
+ *     to fill its inputs, how to call it, and how to check its output
+ *     against a reference version. test-trans, tracegen and time-trans go
+ *     through these, so every kind is scored the same way: validated,
+ *     simulated through the memtrace hooks, and timed natively.
+ *
+ * Every kind takes up to KERNEL_OPERANDS int arrays, passed in ops[]:
+ *
+ *   kind               ops[0]      ops[1]      ops[2]
+ *   KERNEL_TRANSPOSE   A  M x N    B  N x M    -
+ *   KERNEL_GEMM        A  M x N    B  N x M    C  M x M
+ *   KERNEL_STENCIL     A  M x N    B  M x N    -
+ *   KERNEL_MATVEC      A  M x N    x  N        y  M
+ *
+ * GEMM, stencil and matrix-vector inputs are kept below KERNEL_VALUE_RANGE
+ * so that no sum overflows, and the outputs can be compared exactly
+ * whatever order a kernel adds in.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+#include "cachelab.h"
+
+#define KERNEL_OPERANDS 3
+
+/* Inputs of the non-transpose kinds are in [0, KERNEL_VALUE_RANGE) */
+#define KERNEL_VALUE_RANGE 100
+
+/* Where an output first differs from the reference */
+typedef struct kernel_mismatch {
+    int expected, got;
+    char where[32];                 /* e.g. "B[3][7]" or "y[5]" */
+} kernel_mismatch_t;
+
+/* "transpose", "gemm", "stencil" or "matvec" */
+const char* kernel_kind_name(const trans_func_t* f);
+
+/* The name of operand k of f ("A", "B", "C", "x" or "y"), or NULL if unused */
+const char* kernel_operand_name(const trans_func_t* f, int k);
+
+/* Ints in each operand of f for M x N inputs, 0 for unused operands */
+void kernel_operands(const trans_func_t* f, int M, int N,
+                     size_t len[KERNEL_OPERANDS]);
+
+/* Ints to allocate for each operand so that every kind fits */
+void kernel_buffer_sizes(int M, int N, size_t len[KERNEL_OPERANDS]);
+
+/* Fill the inputs of f; in-place transposes also get A copied into B */
+void kernel_init(const trans_func_t* f, int M, int N, int* ops[KERNEL_OPERANDS]);
+
+/* Call f on ops */
+void kernel_run(const trans_func_t* f, int M, int N, int* ops[KERNEL_OPERANDS]);
+
+/*
+ * Compare the output of f with what the reference version computes from
+ * the same inputs. Returns 1 if they agree; otherwise fills *bad with the
+ * first difference and returns 0.
+ */
+int kernel_check(const trans_func_t* f, int M, int N, int* ops[KERNEL_OPERANDS],
+                 kernel_mismatch_t* bad);
+
+/*
+ * Bytes a run of f has to move at the least, every operand read or
+ * written once; bandwidth figures are this over the run time
+ */
+double kernel_bytes(const trans_func_t* f, int M, int N);
+
+#endif /* KERNELS_H */
@@ -0,0 +1,67 @@
+/*
+ * matvec.c - Matrix-vector kernels
+ */
+#include "cachelab.h"
+#include "matvec.h"
+
+/* Columns per block: 128 ints of x fill half of the lab's 1 KiB cache */
+#define MATVEC_BLOCK 128
+
+/*
+ * matvec_rows - One dot product per row of A
+ */
+char matvec_rows_desc[] = "Row-major matrix-vector product";
+void matvec_rows(int M, int N, int A[M][N], int x[N], int y[M]) {
+    int i, j, sum;
+
+    for (i = 0; i < M; i++) {
+        sum = 0;
+        for (j = 0; j < N; j++)
+            sum += A[i][j] * x[j];
+        y[i] = sum;
+    }
+}
+
+/*
+ * matvec_columns - Add each column of A, scaled by its element of x, into y
+ */
+char matvec_columns_desc[] = "Column-major matrix-vector product";
+void matvec_columns(int M, int N, int A[M][N], int x[N], int y[M]) {
+    int i, j, a;
+
+    for (i = 0; i < M; i++)
+        y[i] = 0;
+    for (j = 0; j < N; j++) {
+        a = x[j];
+        for (i = 0; i < M; i++)
+            y[i] += A[i][j] * a;
+    }
+}
+
+/*
+ * matvec_blocked - Partial dot products over one block of columns of
+ *     every row, block by block
+ */
+char matvec_blocked_desc[] = "Column-blocked matrix-vector product";
+void matvec_blocked(int M, int N, int A[M][N], int x[N], int y[M]) {
+    int jj, i, j, sum;
+
+    for (i = 0; i < M; i++)
+        y[i] = 0;
+    for (jj = 0; jj < N; jj += MATVEC_BLOCK)
+        for (i = 0; i < M; i++) {
+            sum = 0;
+            for (j = jj; j < jj + MATVEC_BLOCK && j < N; j++)
+                sum += A[i][j] * x[j];
+            y[i] += sum;
+        }
+}
+
+/*
+ * registerMatvecFunctions - Register the three products
+ */
+void registerMatvecFunctions() {
+    registerMatvecFunction(matvec_rows, matvec_rows_desc);
+    registerMatvecFunction(matvec_columns, matvec_columns_desc);
+    registerMatvecFunction(matvec_blocked, matvec_blocked_desc);
+}
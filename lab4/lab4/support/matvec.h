@@ -0,0 +1,24 @@
+/*
+ * matvec.h - Integer matrix-vector products y = A x, with A M x N, by
+ *     rows, by columns, and by column blocks.
+ */
+
+#ifndef MATVEC_H
+#define MATVEC_H
+
+/* One dot product per row: A is read sequentially and x reused per row */
+void matvec_rows(int M, int N, int A[M][N], int x[N], int y[M]);
+
+/* y += A[.][j] x[j] column by column, walking A down its columns */
+void matvec_columns(int M, int N, int A[M][N], int x[N], int y[M]);
+
+/*
+ * Dot products over MATVEC_BLOCK columns at a time, so the piece of x in
+ * use stays cached across every row even when all of x does not fit
+ */
+void matvec_blocked(int M, int N, int A[M][N], int x[N], int y[M]);
+
+/* Register the products above */
+void registerMatvecFunctions();
+
+#endif /* MATVEC_H */
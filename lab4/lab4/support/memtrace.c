@@ -0,0 +1,234 @@
+/*
+ * memtrace.c - Routes the loads and stores of instrumented code to a cache
+ *     model, in place of running the program under valgrind's lackey tool.
+ *
+ * Compiling with -fsanitize=thread makes gcc call __tsan_read4(addr),
+ * __tsan_write4(addr), etc. around every memory access. We define those
+ * hooks ourselves and do not link the ThreadSanitizer runtime, so they
+ * become a cheap tracing interface. Only accesses that fall in one of the
+ * ranges registered with memtrace_add_range() are simulated, which (like the
+ * address filter in the lackey pipeline) leaves out the stack.
+ *
+ * Each hook passes on its return address, which is just past the access
+ * in the instrumented code, as the access's instruction address. Recorded
+ * traces get an 'I' record whenever it changes, like lackey's "I" lines.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memtrace.h"
+
+#define MAX_TRACE_RANGES 8
+
+/* Distinct instructions tracked for attribution, a power of two */
+#define MAX_SITES 4096
+
+typedef struct trace_range {
+    unsigned long long lo;
+    unsigned long long hi;          /* one past the last traced byte */
+} trace_range_t;
+
+static cache_sim_t* active_sim = NULL;
+static bintrace_t* active_trace = NULL;
+static trace_range_t ranges[MAX_TRACE_RANGES];
+static int num_ranges = 0;
+static const void* last_pc = NULL;      /* last instruction recorded */
+
+/* Attribution totals, open-addressed by pc */
+static cache_stats_t range_counts[MAX_TRACE_RANGES];
+static memtrace_site_t sites[MAX_SITES];
+static int num_sites = 0;
+
+/*
+ * memtrace_begin - Start feeding traced accesses to sim, with fresh
+ *     attribution totals
+ */
+void memtrace_begin(cache_sim_t* sim) {
+    active_sim = sim;
+    memset(range_counts, 0, sizeof(range_counts));
+    memset(sites, 0, sizeof(sites));
+    num_sites = 0;
+}
+
+/*
+ * memtrace_begin_record - Start appending traced accesses to trace
+ */
+void memtrace_begin_record(bintrace_t* trace) {
+    active_trace = trace;
+    last_pc = NULL;
+}
+
+/*
+ * memtrace_add_range - Trace accesses to the len bytes at addr
+ */
+void memtrace_add_range(const void* addr, size_t len) {
+    if (num_ranges == MAX_TRACE_RANGES) {
+        fprintf(stderr, "memtrace: too many traced ranges\n");
+        exit(1);
+    }
+    ranges[num_ranges].lo = (unsigned long long) addr;
+    ranges[num_ranges].hi = (unsigned long long) addr + len;
+    num_ranges++;
+}
+
+/*
+ * memtrace_end - Stop tracing and forget the traced ranges
+ */
+void memtrace_end(void) {
+    active_sim = NULL;
+    active_trace = NULL;
+    num_ranges = 0;
+}
+
+/*
+ * memtrace_active - Report whether accesses are being simulated or recorded
+ */
+int memtrace_active(void) {
+    return active_sim != NULL || active_trace != NULL;
+}
+
+/*
+ * add_counts - Add the change from before to after to *total
+ */
+static void add_counts(cache_stats_t* total, const cache_stats_t* before,
+                       const cache_stats_t* after) {
+    total->hits += after->hits - before->hits;
+    total->misses += after->misses - before->misses;
+    total->evictions += after->evictions - before->evictions;
+    total->writebacks += after->writebacks - before->writebacks;
+    total->victim_hits += after->victim_hits - before->victim_hits;
+    total->compulsory += after->compulsory - before->compulsory;
+    total->capacity += after->capacity - before->capacity;
+    total->conflict += after->conflict - before->conflict;
+}
+
+/*
+ * find_site - The attribution slot for pc, or NULL once MAX_SITES
+ *     instructions are being tracked
+ */
+static memtrace_site_t* find_site(const void* pc) {
+    unsigned long long h = (unsigned long long) pc * 0x9e3779b97f4a7c15ULL;
+    int i = (int) (h >> 52) & (MAX_SITES - 1);
+
+    while (sites[i].pc != NULL && sites[i].pc != pc)
+        i = (i + 1) & (MAX_SITES - 1);
+    if (sites[i].pc == NULL) {
+        if (num_sites == MAX_SITES - 1)
+            return NULL;
+        sites[i].pc = pc;
+        num_sites++;
+    }
+    return &sites[i];
+}
+
+/*
+ * memtrace_access - Simulate or record one access if tracing is on and it
+ *     falls in a traced range
+ */
+void memtrace_access(const void* addr, unsigned int len, int is_store,
+                     const void* pc) {
+    unsigned long long a = (unsigned long long) addr;
+    cache_stats_t before, after;
+    memtrace_site_t* site;
+    int i;
+
+    if (active_sim == NULL && active_trace == NULL)
+        return;
+    for (i = 0; i < num_ranges; i++) {
+        if (a >= ranges[i].lo && a < ranges[i].hi) {
+            if (active_sim != NULL) {
+                cachesim_stats(active_sim, 0, &before);
+                cachesim_set_pc(active_sim, (unsigned long long) pc);
+                cachesim_access(active_sim, a, len, is_store);
+                cachesim_stats(active_sim, 0, &after);
+                add_counts(&range_counts[i], &before, &after);
+                if ((site = find_site(pc)) != NULL)
+                    add_counts(&site->counts, &before, &after);
+            }
+            if (active_trace != NULL) {
+                if (pc != last_pc)
+                    bintrace_write(active_trace, 'I', (unsigned long long) pc, 1);
+                last_pc = pc;
+                bintrace_write(active_trace, is_store ? 'S' : 'L', a, len);
+            }
+            return;
+        }
+    }
+}
+
+/*
+ * memtrace_range_counts - Report the counts charged to range i
+ */
+void memtrace_range_counts(int i, cache_stats_t* counts) {
+    *counts = range_counts[i];
+}
+
+/*
+ * compare_sites - Order sites by misses, most first, then by address
+ */
+static int compare_sites(const void* a, const void* b) {
+    const memtrace_site_t* x = a;
+    const memtrace_site_t* y = b;
+
+    if (x->counts.misses != y->counts.misses)
+        return x->counts.misses < y->counts.misses ? 1 : -1;
+    return x->pc < y->pc ? -1 : x->pc > y->pc;
+}
+
+/*
+ * memtrace_sites - Copy out the instructions with the most misses
+ */
+int memtrace_sites(memtrace_site_t* out, int max) {
+    static memtrace_site_t sorted[MAX_SITES];
+    int i, n = 0;
+
+    for (i = 0; i < MAX_SITES; i++)
+        if (sites[i].pc != NULL)
+            sorted[n++] = sites[i];
+    qsort(sorted, n, sizeof(memtrace_site_t), compare_sites);
+    if (n > max)
+        n = max;
+    memcpy(out, sorted, n * sizeof(memtrace_site_t));
+    return n;
+}
+
+/*
+ * ThreadSanitizer instrumentation hooks. Plain C code only needs the
+ * sized, unaligned and range variants plus function entry/exit.
+ */
+void __tsan_init(void) {}
+void __tsan_func_entry(void* pc) {}
+void __tsan_func_exit(void) {}
+
+/* A sized hook; its return address is in the code that made the access */
+#define TRACE_HOOK(name, len, is_store)                                 \
+    void name(void* addr) {                                             \
+        memtrace_access(addr, len, is_store, __builtin_return_address(0)); \
+    }
+
+TRACE_HOOK(__tsan_read1, 1, 0)
+TRACE_HOOK(__tsan_read2, 2, 0)
+TRACE_HOOK(__tsan_read4, 4, 0)
+TRACE_HOOK(__tsan_read8, 8, 0)
+TRACE_HOOK(__tsan_read16, 16, 0)
+TRACE_HOOK(__tsan_write1, 1, 1)
+TRACE_HOOK(__tsan_write2, 2, 1)
+TRACE_HOOK(__tsan_write4, 4, 1)
+TRACE_HOOK(__tsan_write8, 8, 1)
+TRACE_HOOK(__tsan_write16, 16, 1)
+
+TRACE_HOOK(__tsan_unaligned_read2, 2, 0)
+TRACE_HOOK(__tsan_unaligned_read4, 4, 0)
+TRACE_HOOK(__tsan_unaligned_read8, 8, 0)
+TRACE_HOOK(__tsan_unaligned_read16, 16, 0)
+TRACE_HOOK(__tsan_unaligned_write2, 2, 1)
+TRACE_HOOK(__tsan_unaligned_write4, 4, 1)
+TRACE_HOOK(__tsan_unaligned_write8, 8, 1)
+TRACE_HOOK(__tsan_unaligned_write16, 16, 1)
+
+void __tsan_read_range(void* addr, unsigned long size) {
+    memtrace_access(addr, size, 0, __builtin_return_address(0));
+}
+void __tsan_write_range(void* addr, unsigned long size) {
+    memtrace_access(addr, size, 1, __builtin_return_address(0));
+}
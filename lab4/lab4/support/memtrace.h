@@ -0,0 +1,56 @@
+/*
+ * memtrace.h - Instrumented memory access API. Code compiled with
+ *     -fsanitize=thread (see CFLAGS_SIM in the Makefile) reports each of its
+ *     loads and stores here instead of to the ThreadSanitizer runtime, and
+ *     the accesses that fall in a traced range are fed to a cache model or
+ *     recorded to a binary trace.
+ */
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <stddef.h>
+#include "cachesim.h"
+#include "bintrace.h"
+
+/* Start feeding traced accesses to sim */
+void memtrace_begin(cache_sim_t* sim);
+
+/* Start appending traced accesses to trace */
+void memtrace_begin_record(bintrace_t* trace);
+
+/* Trace accesses to the len bytes at addr (e.g. one matrix) */
+void memtrace_add_range(const void* addr, size_t len);
+
+/* Stop tracing and forget the traced ranges */
+void memtrace_end(void);
+
+/* Nonzero between memtrace_begin*() and memtrace_end() */
+int memtrace_active(void);
+
+/* Report one access from the instruction at pc; called by the hooks */
+void memtrace_access(const void* addr, unsigned int len, int is_store,
+                     const void* pc);
+
+/*
+ * Miss attribution. While simulating, memtrace charges the L1 outcome of
+ * each access (the change it makes to the counters in cache_stats_t) to
+ * the range it falls in and to the instruction that made it. The totals
+ * cover everything since memtrace_begin() and stay readable after
+ * memtrace_end().
+ */
+typedef struct memtrace_site {
+    const void* pc;                 /* instruction address */
+    cache_stats_t counts;
+} memtrace_site_t;
+
+/* Counts charged to the i-th range added since memtrace_begin() */
+void memtrace_range_counts(int i, cache_stats_t* counts);
+
+/*
+ * Copy up to max of the instructions seen, most misses first, into sites.
+ * Returns how many were copied.
+ */
+int memtrace_sites(memtrace_site_t* sites, int max);
+
+#endif /* MEMTRACE_H */
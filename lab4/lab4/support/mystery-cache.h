@@ -21,4 +21,24 @@ bool_t access_cache(addr_t address);
     transitions, by starting from a known state. */
 void flush_cache(void);
 
+/** Cache factory, for drivers that test inference code against many
+    caches in one process (see support/infer-sweep.c). Only the
+    simulated backend in support/mystery-sim.c provides it. */
+typedef struct mystery_cache mystery_cache_t;
+
+/** Creates an empty LRU cache of size bytes, assoc lines per set and
+    block_size bytes per block, the c, e and k of a
+    caches/cache_<c>c_<e>e_<k>k.o object. Returns NULL unless
+    block_size and the set count are powers of two. */
+mystery_cache_t* cache_create(int size, int assoc, int block_size);
+
+/** Frees a cache from cache_create(). It must not be selected by any
+    thread. */
+void cache_destroy(mystery_cache_t* cache);
+
+/** Makes cache the one this thread's access_cache() and flush_cache()
+    calls go to, so inference code written against the functions above
+    runs unchanged, one cache per thread. */
+void cache_select(mystery_cache_t* cache);
+
 #endif
@@ -0,0 +1,301 @@
+/*
+ * mystery-hw.c - A mystery-cache.h backend on this machine's L1 data
+ *     cache. access_cache(a) loads the word at byte a of a large buffer
+ *     (modulo its size, and with its 4 KiB pages scattered; see
+ *     scatter()), timed with clock.c's cycle counter, and calls it a hit
+ *     if it was faster than a threshold between the L1 and L2 hit times.
+ *     cache_init() measures both, retrying until the L2 time is clearly the
+ *     slower and giving up after a few tries; MYSTERY_HW_THRESHOLD (in
+ *     cycles) overrides it.
+ *
+ * The buffer is all zeros and each load's address adds in the value the
+ * previous one returned, so successive accesses form a pointer chase: no
+ * load can start before the one before it has finished.
+ *
+ * A single timed load is too noisy to classify: L1 and L2 hits are only a
+ * few cycles apart next to the counter's own overhead, and interrupts add
+ * far more. So each access is timed up to MEASURE_RUNS times, and it is a
+ * hit if most of those runs beat the threshold: between runs, every line
+ * touched since the last flush_cache() is flushed and the same prefix of
+ * accesses is replayed untimed, to rebuild the same cache state. A vote
+ * rather than the fastest run, since the L1's replacement is not quite
+ * deterministic and a line that was evicted in most runs should count as
+ * a miss. cache_init() picks the threshold that misclassifies the fewest
+ * single loads of a line it knows to be in L1 or in L2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <x86intrin.h>
+#include "mystery-cache.h"
+#include "clock.h"
+#include "chase.h"
+
+/* 64 MiB, far more than any L1, on huge pages: 2^10 chunks of 64 KiB,
+   each 2^4 pages of 4 KiB */
+#define PAGE_BITS 12
+#define CHUNK_BITS 16
+#define BUFFER_CHUNK_BITS 10
+#define BUFFER_SIZE (1UL << (CHUNK_BITS + BUFFER_CHUNK_BITS))
+
+/* Bytes flushed per clflush */
+#define FLUSH_LINE 64
+
+/* Cycles to spin before calibrating, so the core has left any idle or
+   low-frequency state that would skew the estimates */
+#define WARMUP_CYCLES 2e8
+
+/* Timed loads per calibration estimate */
+#define CALIBRATION_ROUNDS 1000
+
+/* Runs of an access that vote on whether it hit */
+#define MEASURE_RUNS 7
+
+/* Calibrations tried before giving up on telling L1 and L2 apart */
+#define CALIBRATION_TRIES 5
+
+/* L2 hits must be this many cycles, and this fraction of an L1 hit,
+   slower than L1 hits, and the threshold between them must misclassify at
+   most this fraction of single loads, for it to mean anything */
+#define MIN_GAP_CYCLES 3
+#define MIN_GAP_FRACTION 0.1
+#define MAX_MISCLASSIFIED 0.2
+
+/* Lines at a 4 KiB stride that evict a line from any L1 but not the L2 */
+#define EVICT_LINES 64
+
+/* Accesses remembered for flush_cache() and for replaying; past this it
+   flushes a range, and accesses are classified from a single run */
+#define MAX_TOUCHED (1 << 16)
+
+static char* buffer = NULL;
+static addr_t link;                     /* last value loaded, always 0 */
+static double threshold;
+static addr_t touched[MAX_TOUCHED];     /* offsets loaded since the last flush */
+static size_t num_touched;
+static addr_t lo_touched, hi_touched;   /* and their range, [lo, hi),
+                                           before scatter() */
+
+/*
+ * scatter - The buffer offset of address a (below BUFFER_SIZE): the same
+ *     offset within a 4 KiB page, in a chunk picked by a bijective hash of
+ *     a's chunk number and rotated within it by a's chunk number. An x86
+ *     L1 is indexed by bits within a page, so it sees the addresses
+ *     unchanged, but the lines of a large power-of-two stride
+ *
+ *   - no longer share a set in L2 and beyond, as they would on huge
+ *     pages, where evictions from a full L2 set take the L1 copies too;
+ *   - no longer share a DTLB set, whose misses would add a few cycles to
+ *     L1 hits and blur them into L2 hits.
+ *
+ * Pages stay next to each other within a chunk, and chunk 0 is not
+ * rotated, since the L1 prefetches the page after a sequential run into
+ * set 0 and only wastes a way on it when that page is not in the run.
+ */
+static addr_t scatter(addr_t a) {
+    const addr_t mask = ((addr_t) 1 << BUFFER_CHUNK_BITS) - 1;
+    const addr_t page_mask = ((addr_t) 1 << (CHUNK_BITS - PAGE_BITS)) - 1;
+    addr_t chunk = a >> CHUNK_BITS;
+    addr_t page = ((a >> PAGE_BITS) + chunk * 5 + (chunk >> 4)) & page_mask;
+
+    /* Multiplying by an odd number and xoring in higher bits are both
+       invertible modulo 2^BUFFER_CHUNK_BITS */
+    chunk = (chunk * 0x2f1b) & mask;
+    chunk ^= chunk >> 5;
+    chunk = (chunk * 0x1a35) & mask;
+    chunk ^= chunk >> 3;
+    chunk = (chunk * 0x3c6d) & mask;
+    return (chunk << CHUNK_BITS) | (page << PAGE_BITS)
+           | (a & (((addr_t) 1 << PAGE_BITS) - 1));
+}
+
+/*
+ * timed_load - Load the word at offset, chained to the previous load, and
+ *     return how many cycles it took
+ */
+static double timed_load(addr_t offset) {
+    double cycles;
+
+    offset &= ~(addr_t) (sizeof(addr_t) - 1);
+    _mm_lfence();
+    start_counter();
+    _mm_lfence();
+    link = *(volatile addr_t*) (buffer + offset + link);
+    _mm_lfence();
+    cycles = get_counter();
+    return cycles;
+}
+
+/*
+ * replay - Flush the first n lines touched since the last flush_cache(),
+ *     and load the first n - 1 again, leaving the cache as it was before
+ *     access n - 1 was made
+ */
+static void replay(size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        _mm_clflush(buffer + touched[i]);
+    _mm_mfence();
+    for (i = 0; i + 1 < n; i++)
+        link = *(volatile addr_t*) (buffer + (touched[i] & ~(addr_t) (sizeof(addr_t) - 1))
+                                    + link);
+}
+
+/*
+ * compare_cycles - qsort order for cycle counts
+ */
+static int compare_cycles(const void* a, const void* b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * sample_latencies - Time CALIBRATION_ROUNDS single loads of line 0, each
+ *     after it has been left in L1 (evict == 0) or pushed out to L2
+ *     (evict == 1), into samples in increasing order
+ */
+static void sample_latencies(int evict, double samples[]) {
+    int round, i;
+
+    for (round = 0; round < CALIBRATION_ROUNDS; round++) {
+        timed_load(0);
+        if (evict)
+            for (i = 1; i <= EVICT_LINES; i++)
+                timed_load((addr_t) i * 4096);
+        samples[round] = timed_load(0);
+    }
+    qsort(samples, CALIBRATION_ROUNDS, sizeof(samples[0]), compare_cycles);
+}
+
+/*
+ * best_threshold - The threshold that calls the fewest of the sorted
+ *     samples l1 misses and l2 hits, a load being a hit if it takes fewer
+ *     cycles. Sets *misclassified to how many it gets wrong.
+ */
+static double best_threshold(const double l1[], const double l2[], int* misclassified) {
+    double best = l2[0];
+    int i = 0, j = 0, wrong, fewest = CALIBRATION_ROUNDS;
+
+    /* Try each l2 sample as the threshold: l1 samples from i on and l2
+       samples before j are wrong */
+    for (j = 0; j < CALIBRATION_ROUNDS; j++) {
+        if (j > 0 && l2[j] == l2[j - 1])
+            continue;
+        while (i < CALIBRATION_ROUNDS && l1[i] < l2[j])
+            i++;
+        wrong = (CALIBRATION_ROUNDS - i) + j;
+        if (wrong < fewest) {
+            fewest = wrong;
+            best = l2[j];
+        }
+    }
+    *misclassified = fewest;
+    return best;
+}
+
+/*
+ * calibrated - Is an L2 hit of l2 cycles clearly slower than an L1 hit of
+ *     l1 cycles, and does the threshold tell most loads of each apart?
+ */
+static int calibrated(double l1, double l2, int misclassified) {
+    return l2 - l1 >= MIN_GAP_CYCLES && l2 - l1 >= l1 * MIN_GAP_FRACTION
+           && misclassified <= 2 * CALIBRATION_ROUNDS * MAX_MISCLASSIFIED;
+}
+
+/*
+ * cache_init - Allocate the buffer and pick the hit/miss threshold
+ */
+void cache_init(int size, int block_size) {
+    static double l1[CALIBRATION_ROUNDS], l2[CALIBRATION_ROUNDS];
+    const char* forced = getenv("MYSTERY_HW_THRESHOLD");
+    int try, misclassified;
+
+    if (buffer == NULL)
+        buffer = chase_alloc(BUFFER_SIZE, 1);
+
+    if (forced != NULL) {
+        threshold = strtod(forced, NULL);
+    } else {
+        start_counter();
+        while (get_counter() < WARMUP_CYCLES)
+            ;
+        for (try = 1; try <= CALIBRATION_TRIES; try++) {
+            sample_latencies(0, l1);
+            sample_latencies(1, l2);
+            threshold = best_threshold(l1, l2, &misclassified);
+            if (calibrated(l1[CALIBRATION_ROUNDS / 2], l2[CALIBRATION_ROUNDS / 2],
+                           misclassified))
+                break;
+            fprintf(stderr, "mystery-hw: L1 hit %.0f cycles, L2 hit %.0f cycles, "
+                    "too close to tell apart (try %d of %d)\n",
+                    l1[CALIBRATION_ROUNDS / 2], l2[CALIBRATION_ROUNDS / 2],
+                    try, CALIBRATION_TRIES);
+        }
+        if (try > CALIBRATION_TRIES) {
+            fprintf(stderr, "mystery-hw: Unable to calibrate; "
+                    "set MYSTERY_HW_THRESHOLD to the cycles between an L1 and an L2 hit\n");
+            exit(1);
+        }
+        fprintf(stderr, "mystery-hw: L1 hit %.0f cycles, L2 hit %.0f cycles, "
+                "threshold %.1f (%.1f%% of loads misclassified)\n",
+                l1[CALIBRATION_ROUNDS / 2], l2[CALIBRATION_ROUNDS / 2], threshold,
+                100.0 * misclassified / (2 * CALIBRATION_ROUNDS));
+    }
+    num_touched = 0;
+    lo_touched = BUFFER_SIZE;
+    hi_touched = 0;
+}
+
+/*
+ * access_cache - Time one load, then replay the accesses before it and
+ *     time it again until most of MEASURE_RUNS runs agree
+ */
+bool_t access_cache(addr_t address) {
+    addr_t unscattered = address % BUFFER_SIZE;
+    addr_t offset = scatter(unscattered);
+    int hits = 0, misses = 0;
+
+    if (num_touched < MAX_TOUCHED)
+        touched[num_touched] = offset;
+    num_touched++;
+    if (unscattered < lo_touched)
+        lo_touched = unscattered;
+    if (unscattered + 1 > hi_touched)
+        hi_touched = unscattered + 1;
+
+    if (num_touched > MAX_TOUCHED)
+        return timed_load(offset) < threshold ? TRUE : FALSE;
+    for (;;) {
+        if (timed_load(offset) < threshold)
+            hits++;
+        else
+            misses++;
+        if (2 * hits > MEASURE_RUNS || 2 * misses > MEASURE_RUNS)
+            break;
+        replay(num_touched);
+    }
+    return hits > misses ? TRUE : FALSE;
+}
+
+/*
+ * flush_cache - clflush every line touched since the last flush, or the
+ *     whole range between them if there were too many to remember
+ */
+void flush_cache(void) {
+    addr_t offset;
+    size_t i;
+
+    if (num_touched <= MAX_TOUCHED) {
+        for (i = 0; i < num_touched; i++)
+            _mm_clflush(buffer + touched[i]);
+    } else {
+        for (offset = lo_touched & ~(addr_t) (FLUSH_LINE - 1); offset < hi_touched;
+             offset += FLUSH_LINE)
+            _mm_clflush(buffer + scatter(offset));
+    }
+    _mm_mfence();
+    num_touched = 0;
+    lo_touched = BUFFER_SIZE;
+    hi_touched = 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * mystery-sim.c - A mystery-cache.h backend on the cachesim model, for
+ *     testing cache inference against any geometry. Like the mystery cache
+ *     objects it ignores cache_init()'s arguments; the geometry comes from
+ *     the MYSTERY_CACHE environment variable instead, written as
+ *     "s,E,b[,policy[,victim_lines]]" the way csim's -2 option takes it.
+ *
+ * It is also the one backend with the cache factory: each thread's
+ * access_cache() and flush_cache() go to the cache it last selected, or
+ * to the MYSTERY_CACHE one if it never did.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cachesim.h"
+#include "mystery-cache.h"
+
+/* Used when MYSTERY_CACHE is not set: 4 KiB, 4-way, 32-byte blocks */
+#define DEFAULT_GEOMETRY "5,4,5,lru,0"
+
+struct mystery_cache {
+    cache_sim_t* sim;
+};
+
+static mystery_cache_t env_cache;       /* the one cache_init() builds */
+static _Thread_local mystery_cache_t* current = &env_cache;
+
+/*
+ * parse_geometry - Parse "s,E,b[,policy[,victim_lines]]" into config,
+ *     exiting on a bad description
+ */
+static void parse_geometry(const char* arg, cache_config_t* config) {
+    char policy[16] = "lru";
+    int n = sscanf(arg, "%u,%u,%u,%15[a-z],%u", &config->s, &config->E,
+                   &config->b, policy, &config->victim_lines);
+
+    if (n < 5)
+        config->victim_lines = 0;
+    config->prefetch = CACHESIM_PREFETCH_NONE;
+    if (n >= 3 && strcmp(policy, "lru") == 0)
+        config->policy = CACHESIM_LRU;
+    else if (n >= 3 && strcmp(policy, "fifo") == 0)
+        config->policy = CACHESIM_FIFO;
+    else if (n >= 3 && strcmp(policy, "random") == 0)
+        config->policy = CACHESIM_RANDOM;
+    else if (n >= 3 && strcmp(policy, "plru") == 0)
+        config->policy = CACHESIM_PLRU;
+    else {
+        fprintf(stderr, "Bad MYSTERY_CACHE '%s', expected s,E,b[,policy[,victims]]\n", arg);
+        exit(1);
+    }
+}
+
+/*
+ * cache_init - Build the cache MYSTERY_CACHE describes
+ */
+void cache_init(int size, int block_size) {
+    const char* geometry = getenv("MYSTERY_CACHE");
+    cache_config_t config;
+
+    parse_geometry(geometry != NULL ? geometry : DEFAULT_GEOMETRY, &config);
+    cachesim_free(env_cache.sim);
+    env_cache.sim = cachesim_create_hierarchy(&config, 1);
+    if (env_cache.sim == NULL) {
+        fprintf(stderr, "Invalid MYSTERY_CACHE geometry\n");
+        exit(1);
+    }
+    current = &env_cache;
+}
+
+/*
+ * log2_exact - log2(n) if n is a power of two, otherwise -1
+ */
+static int log2_exact(int n) {
+    int log = 0;
+
+    if (n <= 0 || (n & (n - 1)) != 0)
+        return -1;
+    while ((1 << log) < n)
+        log++;
+    return log;
+}
+
+/*
+ * cache_create - Build an LRU cache from its size, associativity and
+ *     block size
+ */
+mystery_cache_t* cache_create(int size, int assoc, int block_size) {
+    cache_config_t config = { 0, 0, 0, CACHESIM_LRU, 0, CACHESIM_PREFETCH_NONE };
+    mystery_cache_t* cache;
+    int s, b;
+
+    if (size <= 0 || assoc <= 0 || block_size <= 0
+        || size % assoc != 0 || size / assoc % block_size != 0)
+        return NULL;
+    s = log2_exact(size / assoc / block_size);
+    b = log2_exact(block_size);
+    if (s < 0 || b < 0)
+        return NULL;
+    config.s = s;
+    config.E = assoc;
+    config.b = b;
+
+    cache = malloc(sizeof(mystery_cache_t));
+    if (cache == NULL)
+        return NULL;
+    cache->sim = cachesim_create_hierarchy(&config, 1);
+    if (cache->sim == NULL) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+/*
+ * cache_destroy - Free a cache from cache_create()
+ */
+void cache_destroy(mystery_cache_t* cache) {
+    if (cache == NULL)
+        return;
+    cachesim_free(cache->sim);
+    free(cache);
+}
+
+/*
+ * cache_select - Point this thread's accesses at cache
+ */
+void cache_select(mystery_cache_t* cache) {
+    current = cache;
+}
+
+/*
+ * access_cache - Load one byte and report whether it hit
+ */
+bool_t access_cache(addr_t address) {
+    cache_stats_t before, after;
+
+    cachesim_stats(current->sim, 0, &before);
+    cachesim_access(current->sim, address, 1, 0);
+    cachesim_stats(current->sim, 0, &after);
+    return after.hits > before.hits ? TRUE : FALSE;
+}
+
+/*
+ * flush_cache - Empty the cache and its victim buffer
+ */
+void flush_cache(void) {
+    cachesim_reset(current->sim);
+}
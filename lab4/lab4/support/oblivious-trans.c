@@ -0,0 +1,138 @@
+/*
+ * oblivious-trans.c - Recursive cache-oblivious transposes, serial and on
+ *     a work-stealing pool
+ */
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "cachelab.h"
+#include "memtrace.h"
+#include "threadpool.h"
+#include "simd-trans.h"
+#include "oblivious-trans.h"
+
+/*
+ * Stop recursing at 32x32 ints: 4 KiB of A plus 4 KiB of B, which fits in
+ * any current L1 data cache with room to spare. The leaf goes through it in
+ * register tiles, so smaller caches (like the lab's 1 KiB one) still see
+ * one tile's rows at a time.
+ */
+#define LEAF_SIZE 32
+
+/* Splits fall on multiples of the widest register tile from the region's
+   start, so the leaves are made of whole tiles */
+#define SPLIT_ALIGN 16
+
+/* Subproblems with fewer elements than this are not worth a task */
+#define PARALLEL_MIN (128 * 128)
+
+/* A rows [i0, i1) x columns [j0, j1) block of A, to transpose into B */
+typedef struct region {
+    int M, N;
+    int* A;
+    int* B;
+    int i0, i1, j0, j1;
+    tpool_t* pool;                  /* NULL to stay on this thread */
+} region_t;
+
+static tpool_t* pool = NULL;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+/*
+ * create_pool - Start the shared pool with one worker per CPU
+ */
+static void create_pool(void) {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    pool = tpool_create(ncpus > 0 ? (int) ncpus : 1);
+}
+
+/*
+ * trans_leaf - Transpose a region small enough to stay in cache, with the
+ *     SIMD kernels' register tiles
+ */
+static void trans_leaf(const region_t* r) {
+    transpose_simd_region(r->M, r->N, (int (*)[r->N]) r->A, (int (*)[r->M]) r->B,
+                          r->i0, r->i1, r->j0, r->j1);
+}
+
+static void trans_region(const region_t* r);
+
+/*
+ * trans_region_task - Pool entry point for one half of a split
+ */
+static void trans_region_task(void* arg) {
+    trans_region(arg);
+}
+
+/*
+ * split_point - Where to split n rows or columns starting at start: about
+ *     halfway, on a multiple of SPLIT_ALIGN if the halves are that big
+ */
+static int split_point(int start, int n) {
+    int half = n / 2;
+
+    if (half >= SPLIT_ALIGN)
+        half -= half % SPLIT_ALIGN;
+    return start + half;
+}
+
+/*
+ * trans_region - Split r in half along its longer side and transpose both
+ *     halves, the first one as a pool task if r is big enough to share
+ */
+static void trans_region(const region_t* r) {
+    int rows = r->i1 - r->i0;
+    int cols = r->j1 - r->j0;
+    region_t first = *r, second = *r;
+    tpool_group_t group = TPOOL_GROUP_INIT;
+
+    if (rows <= LEAF_SIZE && cols <= LEAF_SIZE) {
+        trans_leaf(r);
+        return;
+    }
+    if (rows >= cols) {
+        first.i1 = second.i0 = split_point(r->i0, rows);
+    } else {
+        first.j1 = second.j0 = split_point(r->j0, cols);
+    }
+
+    if (r->pool != NULL && (long) rows * cols >= PARALLEL_MIN) {
+        tpool_spawn(r->pool, &group, trans_region_task, &first);
+        trans_region(&second);
+        tpool_wait(r->pool, &group);
+    } else {
+        trans_region(&first);
+        trans_region(&second);
+    }
+}
+
+/*
+ * transpose_oblivious - Recursive transpose on the calling thread
+ */
+char transpose_oblivious_desc[] = "Cache-oblivious recursive transpose";
+void transpose_oblivious(int M, int N, int A[M][N], int B[N][M]) {
+    region_t r = { M, N, &A[0][0], &B[0][0], 0, M, 0, N, NULL };
+    trans_region(&r);
+}
+
+/*
+ * transpose_oblivious_parallel - Recursive transpose on the shared pool
+ */
+char transpose_oblivious_parallel_desc[] = "Parallel cache-oblivious recursive transpose";
+void transpose_oblivious_parallel(int M, int N, int A[M][N], int B[N][M]) {
+    region_t r = { M, N, &A[0][0], &B[0][0], 0, M, 0, N, NULL };
+
+    if (!memtrace_active()) {
+        pthread_once(&pool_once, create_pool);
+        r.pool = pool;
+    }
+    trans_region(&r);
+}
+
+/*
+ * registerObliviousFunctions - Register the serial and parallel versions
+ */
+void registerObliviousFunctions() {
+    registerTransFunction(transpose_oblivious, transpose_oblivious_desc);
+    registerTransFunction(transpose_oblivious_parallel, transpose_oblivious_parallel_desc);
+}
@@ -0,0 +1,25 @@
+/*
+ * oblivious-trans.h - Cache-oblivious recursive transposes. The matrix is
+ *     halved along its longer side until the pieces fit in any reasonable
+ *     cache, so no tile size has to be tuned per machine. The parallel
+ *     version runs the halves of large subproblems on a work-stealing
+ *     thread pool (see threadpool.h).
+ */
+
+#ifndef OBLIVIOUS_TRANS_H
+#define OBLIVIOUS_TRANS_H
+
+/* Recursive transpose on the calling thread */
+void transpose_oblivious(int M, int N, int A[M][N], int B[N][M]);
+
+/*
+ * Recursive transpose on a pool with one worker per CPU, created on first
+ * use. Runs serially while memtrace is tracing, since the cache model
+ * expects a single stream of accesses.
+ */
+void transpose_oblivious_parallel(int M, int N, int A[M][N], int B[N][M]);
+
+/* Register both transposes above */
+void registerObliviousFunctions();
+
+#endif /* OBLIVIOUS_TRANS_H */
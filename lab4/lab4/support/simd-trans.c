@@ -0,0 +1,201 @@
+/*
+ * simd-trans.c - AVX2 and AVX-512 transposes with runtime CPU dispatch.
+ *
+ * Each kernel is compiled for its instruction set with a target attribute,
+ * so the rest of the lab still builds for baseline x86-64, and is only
+ * called after __builtin_cpu_supports() confirms the CPU has it. Under
+ * CFLAGS_SIM gcc reports the vector loads and stores through
+ * __tsan_read_range() and __tsan_write_range(), so the cache model sees
+ * them as whole-row accesses.
+ */
+#include <immintrin.h>
+#include "cachelab.h"
+#include "simd-trans.h"
+
+#define SCALAR_TILE 8
+
+/*
+ * trans_scalar_block - Transpose rows [i0, i1) x columns [j0, j1) of A
+ *     one 8x8 tile at a time
+ */
+static void trans_scalar_block(int M, int N, int A[M][N], int B[N][M],
+                               int i0, int i1, int j0, int j1) {
+    int ii, jj, i, j;
+
+    for (ii = i0; ii < i1; ii += SCALAR_TILE)
+        for (jj = j0; jj < j1; jj += SCALAR_TILE)
+            for (i = ii; i < ii + SCALAR_TILE && i < i1; i++)
+                for (j = jj; j < jj + SCALAR_TILE && j < j1; j++)
+                    B[j][i] = A[i][j];
+}
+
+/* Transposes the tile x tile block of A at (i, j) into B */
+typedef void (*tile_fn_t)(int M, int N, int A[M][N], int B[N][M], int i, int j);
+
+/*
+ * trans_tiled - Transpose rows [i0, i1) x columns [j0, j1) of A with
+ *     whole tiles from kernel, then the columns right of the last whole
+ *     tile, then the rows below it, with the scalar blocks
+ */
+static void trans_tiled(int M, int N, int A[M][N], int B[N][M], int i0, int i1,
+                        int j0, int j1, int tile, tile_fn_t kernel) {
+    int iT = i1 - (i1 - i0) % tile;
+    int jT = j1 - (j1 - j0) % tile;
+    int i, j;
+
+    for (i = i0; i < iT; i += tile)
+        for (j = j0; j < jT; j += tile)
+            kernel(M, N, A, B, i, j);
+    trans_scalar_block(M, N, A, B, i0, i1, jT, j1);
+    trans_scalar_block(M, N, A, B, iT, i1, j0, jT);
+}
+
+/*
+ * transpose_blocked_scalar - Transpose one 8x8 tile at a time
+ */
+char transpose_blocked_scalar_desc[] = "Blocked 8x8 scalar transpose";
+void transpose_blocked_scalar(int M, int N, int A[M][N], int B[N][M]) {
+    trans_scalar_block(M, N, A, B, 0, M, 0, N);
+}
+
+/*
+ * trans_8x8_avx2 - Transpose the 8x8 tile of A at (i, j) into B
+ */
+__attribute__((target("avx2")))
+static void trans_8x8_avx2(int M, int N, int A[M][N], int B[N][M], int i, int j) {
+    __m256i r0 = _mm256_loadu_si256((const __m256i*) &A[i + 0][j]);
+    __m256i r1 = _mm256_loadu_si256((const __m256i*) &A[i + 1][j]);
+    __m256i r2 = _mm256_loadu_si256((const __m256i*) &A[i + 2][j]);
+    __m256i r3 = _mm256_loadu_si256((const __m256i*) &A[i + 3][j]);
+    __m256i r4 = _mm256_loadu_si256((const __m256i*) &A[i + 4][j]);
+    __m256i r5 = _mm256_loadu_si256((const __m256i*) &A[i + 5][j]);
+    __m256i r6 = _mm256_loadu_si256((const __m256i*) &A[i + 6][j]);
+    __m256i r7 = _mm256_loadu_si256((const __m256i*) &A[i + 7][j]);
+
+    /* Interleave pairs of rows: t0 = a0 b0 a1 b1 | a4 b4 a5 b5, ... */
+    __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+    __m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+    __m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+    __m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+    __m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+    /* Interleave pairs of pairs: u0 = a0 b0 c0 d0 | a4 b4 c4 d4, ... */
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    /* Join the 128-bit halves of rows 0-3 and 4-7 into whole columns */
+    _mm256_storeu_si256((__m256i*) &B[j + 0][i], _mm256_permute2x128_si256(u0, u4, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[j + 1][i], _mm256_permute2x128_si256(u1, u5, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[j + 2][i], _mm256_permute2x128_si256(u2, u6, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[j + 3][i], _mm256_permute2x128_si256(u3, u7, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[j + 4][i], _mm256_permute2x128_si256(u0, u4, 0x31));
+    _mm256_storeu_si256((__m256i*) &B[j + 5][i], _mm256_permute2x128_si256(u1, u5, 0x31));
+    _mm256_storeu_si256((__m256i*) &B[j + 6][i], _mm256_permute2x128_si256(u2, u6, 0x31));
+    _mm256_storeu_si256((__m256i*) &B[j + 7][i], _mm256_permute2x128_si256(u3, u7, 0x31));
+}
+
+/*
+ * transpose_avx2 - Transpose 8x8 tiles in AVX2 registers
+ */
+char transpose_avx2_desc[] = "AVX2 8x8 register-tiled transpose";
+void transpose_avx2(int M, int N, int A[M][N], int B[N][M]) {
+    if (!__builtin_cpu_supports("avx2")) {
+        transpose_blocked_scalar(M, N, A, B);
+        return;
+    }
+    trans_tiled(M, N, A, B, 0, M, 0, N, 8, trans_8x8_avx2);
+}
+
+/*
+ * trans_16x16_avx512 - Transpose the 16x16 tile of A at (i, j) into B
+ */
+__attribute__((target("avx512f")))
+static void trans_16x16_avx512(int M, int N, int A[M][N], int B[N][M], int i, int j) {
+    __m512i r[16], t[16], u[16];
+    __m512i lo01, hi01, lo23, hi23;
+    int k, m;
+
+    for (k = 0; k < 16; k++)
+        r[k] = _mm512_loadu_si512((const void*) &A[i + k][j]);
+
+    /* Interleave pairs of rows, then pairs of pairs, within each 128-bit
+       lane: lane L of u[4g + m] is column 4L + m of rows 4g..4g+3 */
+    for (k = 0; k < 16; k += 2) {
+        t[k] = _mm512_unpacklo_epi32(r[k], r[k + 1]);
+        t[k + 1] = _mm512_unpackhi_epi32(r[k], r[k + 1]);
+    }
+    for (k = 0; k < 16; k += 4) {
+        u[k + 0] = _mm512_unpacklo_epi64(t[k], t[k + 2]);
+        u[k + 1] = _mm512_unpackhi_epi64(t[k], t[k + 2]);
+        u[k + 2] = _mm512_unpacklo_epi64(t[k + 1], t[k + 3]);
+        u[k + 3] = _mm512_unpackhi_epi64(t[k + 1], t[k + 3]);
+    }
+
+    /* Gather lane L of the four row groups into column 4L + m */
+    for (m = 0; m < 4; m++) {
+        lo01 = _mm512_shuffle_i32x4(u[m], u[4 + m], 0x44);
+        hi01 = _mm512_shuffle_i32x4(u[m], u[4 + m], 0xee);
+        lo23 = _mm512_shuffle_i32x4(u[8 + m], u[12 + m], 0x44);
+        hi23 = _mm512_shuffle_i32x4(u[8 + m], u[12 + m], 0xee);
+        _mm512_storeu_si512((void*) &B[j + m][i], _mm512_shuffle_i32x4(lo01, lo23, 0x88));
+        _mm512_storeu_si512((void*) &B[j + 4 + m][i], _mm512_shuffle_i32x4(lo01, lo23, 0xdd));
+        _mm512_storeu_si512((void*) &B[j + 8 + m][i], _mm512_shuffle_i32x4(hi01, hi23, 0x88));
+        _mm512_storeu_si512((void*) &B[j + 12 + m][i], _mm512_shuffle_i32x4(hi01, hi23, 0xdd));
+    }
+}
+
+/*
+ * transpose_avx512 - Transpose 16x16 tiles in AVX-512 registers
+ */
+char transpose_avx512_desc[] = "AVX-512 16x16 register-tiled transpose";
+void transpose_avx512(int M, int N, int A[M][N], int B[N][M]) {
+    if (!__builtin_cpu_supports("avx512f")) {
+        transpose_avx2(M, N, A, B);
+        return;
+    }
+    trans_tiled(M, N, A, B, 0, M, 0, N, 16, trans_16x16_avx512);
+}
+
+/*
+ * transpose_simd_region - Transpose rows [i0, i1) x columns [j0, j1) of A
+ *     with the widest tiles this CPU supports
+ */
+void transpose_simd_region(int M, int N, int A[M][N], int B[N][M],
+                           int i0, int i1, int j0, int j1) {
+    if (__builtin_cpu_supports("avx512f"))
+        trans_tiled(M, N, A, B, i0, i1, j0, j1, 16, trans_16x16_avx512);
+    else if (__builtin_cpu_supports("avx2"))
+        trans_tiled(M, N, A, B, i0, i1, j0, j1, 8, trans_8x8_avx2);
+    else
+        trans_scalar_block(M, N, A, B, i0, i1, j0, j1);
+}
+
+/*
+ * transpose_simd - Run the widest kernel this CPU supports
+ */
+char transpose_simd_desc[] = "SIMD transpose (runtime dispatch)";
+void transpose_simd(int M, int N, int A[M][N], int B[N][M]) {
+    transpose_simd_region(M, N, A, B, 0, M, 0, N);
+}
+
+/*
+ * registerSimdFunctions - Register the scalar fallback and every SIMD
+ *     kernel this CPU can run
+ */
+void registerSimdFunctions() {
+    registerTransFunction(transpose_blocked_scalar, transpose_blocked_scalar_desc);
+    if (__builtin_cpu_supports("avx2"))
+        registerTransFunction(transpose_avx2, transpose_avx2_desc);
+    if (__builtin_cpu_supports("avx512f"))
+        registerTransFunction(transpose_avx512, transpose_avx512_desc);
+    registerTransFunction(transpose_simd, transpose_simd_desc);
+}
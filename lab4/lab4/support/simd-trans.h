@@ -0,0 +1,35 @@
+/*
+ * simd-trans.h - Vectorized transposes with the usual
+ *     void f(int M, int N, int A[M][N], int B[N][M]) signature. The AVX2
+ *     kernel transposes 8x8 tiles and the AVX-512 kernel 16x16 tiles in
+ *     registers; both fall back to a blocked scalar transpose on CPUs
+ *     without the instructions, and for the edges of matrices whose sizes
+ *     are not a multiple of the tile.
+ */
+
+#ifndef SIMD_TRANS_H
+#define SIMD_TRANS_H
+
+/* Blocked 8x8 scalar transpose, the fallback for the kernels below */
+void transpose_blocked_scalar(int M, int N, int A[M][N], int B[N][M]);
+
+/* 8x8 tiles transposed with AVX2 unpack/permute shuffles */
+void transpose_avx2(int M, int N, int A[M][N], int B[N][M]);
+
+/* 16x16 tiles transposed with AVX-512 unpack/shuffle_i32x4 */
+void transpose_avx512(int M, int N, int A[M][N], int B[N][M]);
+
+/* The widest of the kernels above that this CPU supports */
+void transpose_simd(int M, int N, int A[M][N], int B[N][M]);
+
+/*
+ * Transpose rows [i0, i1) x columns [j0, j1) of A into B with the widest
+ * kernel this CPU supports, for callers that split the matrix themselves
+ */
+void transpose_simd_region(int M, int N, int A[M][N], int B[N][M],
+                           int i0, int i1, int j0, int j1);
+
+/* Register the scalar kernel and each SIMD kernel this CPU supports */
+void registerSimdFunctions();
+
+#endif /* SIMD_TRANS_H */
@@ -0,0 +1,81 @@
+/*
+ * stencil.c - 5-point stencil sweeps
+ */
+#include "cachelab.h"
+#include "stencil.h"
+
+/* 8 ints is one 32-byte block */
+#define STENCIL_STRIP 8
+
+/*
+ * point - The new value of interior point (i, j)
+ */
+static inline int point(int M, int N, int A[M][N], int i, int j) {
+    return (A[i][j] + A[i - 1][j] + A[i + 1][j] + A[i][j - 1] + A[i][j + 1]) / 5;
+}
+
+/*
+ * copy_border - Copy the first and last rows and columns of A into B
+ */
+static void copy_border(int M, int N, int A[M][N], int B[M][N]) {
+    int i, j;
+
+    for (j = 0; j < N; j++) {
+        B[0][j] = A[0][j];
+        B[M - 1][j] = A[M - 1][j];
+    }
+    for (i = 1; i < M - 1; i++) {
+        B[i][0] = A[i][0];
+        B[i][N - 1] = A[i][N - 1];
+    }
+}
+
+/*
+ * stencil_rows - Sweep the interior row by row
+ */
+char stencil_rows_desc[] = "Row-major 5-point stencil";
+void stencil_rows(int M, int N, int A[M][N], int B[M][N]) {
+    int i, j;
+
+    copy_border(M, N, A, B);
+    for (i = 1; i < M - 1; i++)
+        for (j = 1; j < N - 1; j++)
+            B[i][j] = point(M, N, A, i, j);
+}
+
+/*
+ * stencil_columns - Sweep the interior column by column
+ */
+char stencil_columns_desc[] = "Column-major 5-point stencil";
+void stencil_columns(int M, int N, int A[M][N], int B[M][N]) {
+    int i, j;
+
+    copy_border(M, N, A, B);
+    for (j = 1; j < N - 1; j++)
+        for (i = 1; i < M - 1; i++)
+            B[i][j] = point(M, N, A, i, j);
+}
+
+/*
+ * stencil_strips - Sweep the interior strip by strip, row by row within
+ *     each strip
+ */
+char stencil_strips_desc[] = "Strip-mined 5-point stencil";
+void stencil_strips(int M, int N, int A[M][N], int B[M][N]) {
+    int jj, i, j;
+
+    copy_border(M, N, A, B);
+    for (jj = 1; jj < N - 1; jj += STENCIL_STRIP)
+        for (i = 1; i < M - 1; i++)
+            for (j = jj; j < jj + STENCIL_STRIP && j < N - 1; j++)
+                B[i][j] = point(M, N, A, i, j);
+}
+
+/*
+ * registerStencilFunctions - Register the three sweeps
+ */
+void registerStencilFunctions() {
+    registerStencilFunction(stencil_rows, stencil_rows_desc);
+    registerStencilFunction(stencil_columns, stencil_columns_desc);
+    registerStencilFunction(stencil_strips, stencil_strips_desc);
+}
@@ -0,0 +1,27 @@
+/*
+ * stencil.h - One sweep of a 5-point Jacobi stencil over an M x N grid:
+ *     B[i][j] is the average of A[i][j] and its four neighbours, and the
+ *     border of B is copied from A. The sweeps differ only in the order
+ *     they visit the grid.
+ */
+
+#ifndef STENCIL_H
+#define STENCIL_H
+
+/* Row by row, so each access to A is next to the previous one */
+void stencil_rows(int M, int N, int A[M][N], int B[M][N]);
+
+/* Column by column, so every access is a row (N ints) from the last */
+void stencil_columns(int M, int N, int A[M][N], int B[M][N]);
+
+/*
+ * Row by row within vertical strips STENCIL_STRIP columns wide, so only
+ * three strip-wide pieces of rows of A need to stay cached, however wide
+ * the grid is
+ */
+void stencil_strips(int M, int N, int A[M][N], int B[M][N]);
+
+/* Register the sweeps above */
+void registerStencilFunctions();
+
+#endif /* STENCIL_H */
@@ -1,8 +1,19 @@
 /*
  * test-trans.c - Checks the correctness and performance of all of the
  *     student's transpose functions and records the results for their
- *     official submitted version as well.
+ *     official submitted version as well. With -K it also scores the GEMM,
+ *     stencil and matrix-vector kernels the same way (see kernels.h).
+ *
+ * With -f the cache model gets a prefetcher, and with -G each function is
+ * also timed by ./time-trans, natively on large square matrices, and its
+ * measured bandwidth is printed beside its simulated misses. The two runs
+ * differ in size, so the miss rate is the simulated figure to compare.
+ *
+ * With -C each function scored in-process is also recorded by ./tracegen -B
+ * and replayed through ./csim, and its counts must come out the same both
+ * ways; test-trans exits with status 1 if any function's differ.
  */
+#define _GNU_SOURCE  /* for popen() and dladdr() under -std=c18 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -10,14 +21,23 @@
 #include <string.h>
 #include <signal.h>
 #include <getopt.h>
+#include <dlfcn.h>
 #include <sys/types.h>
 #include "cachelab.h"
+#include "cachesim.h"
+#include "memtrace.h"
+#include "bintrace.h"
+#include "simd-trans.h"
+#include "oblivious-trans.h"
+#include "inplace-trans.h"
+#include "typed-trans.h"
+#include "gemm.h"
+#include "stencil.h"
+#include "matvec.h"
+#include "kernels.h"
 #include <sys/wait.h>  // for WEXITSTATUS
 #include <limits.h>    // for INT_MAX
 
-/* Maximum array dimension */
-#define MAXN 256
-
 /* The description string for the transpose_submit() function that the
    student submits for credit */
 #define SUBMIT_DESCRIPTION "Transpose submission"
@@ -25,6 +45,9 @@
 /* External function defined in trans.c */
 extern void registerFunctions();
 
+/* Defined in trans-tuned.c, if ./autotune has written one */
+extern void registerTunedFunctions() __attribute__((weak));
+
 /* External variables defined in cachelab-tools.c */
 extern trans_func_t func_list[MAX_TRANS_FUNCS];
 extern int func_counter;
@@ -32,6 +55,27 @@ extern int func_counter;
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static int use_lackey = 0;  /* evaluate with valgrind and ./csim (-L) */
+static int num_workers = 1; /* functions evaluated at once (-j) */
+static int use_simd = 0;    /* also evaluate the SIMD kernels (-S) */
+static int use_oblivious = 0; /* also evaluate the recursive kernels (-P) */
+static int use_inplace = 0; /* also evaluate the in-place kernels (-I) */
+static int use_typed = 0;   /* also evaluate the generic kernels (-T) */
+static int use_kernels = 0; /* also evaluate GEMM, stencil and matvec (-K) */
+static int attribute = 0;   /* break the misses down (-A) */
+static cache_prefetch_t prefetch = CACHESIM_PREFETCH_NONE; /* (-f) */
+static const char* prefetch_name = "none";
+static int native_size = 0; /* time natively on this size matrices (-G) */
+static int cross_check = 0; /* replay each trace through ./csim too (-C) */
+static int typed_failures = 0; /* generic kernel check failures (-T) */
+static unsigned long long seed = CACHELAB_DEFAULT_SEED; /* matrix values (-R) */
+
+/* Instructions listed in a miss breakdown */
+#define TOP_SITES 10
+
+/* Operands for in-process evaluation, allocated in main() big enough for
+   every kind of kernel */
+static int* ops[KERNEL_OPERANDS];
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -41,118 +85,553 @@ struct results {
 };
 static struct results results = {-1, 0, INT_MAX};
 
-/* 
- * eval_perf - Evaluate the performance of the registered transpose functions
- */
-void eval_perf(unsigned int s, unsigned int E, unsigned int b) {
-    int i, flag;
-    unsigned int len, hits, misses, evictions;
-    unsigned long long int marker_start, marker_end, addr;
-    char buf[1000], cmd[255];
-    char filename[128];
+/* The outcome of evaluating one function, sent back by parallel workers */
+struct func_result {
+    int correct;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+    unsigned long long prefetches;
+    unsigned long long prefetch_hits;
+    int replay_differs;     /* -C found different counts through ./csim */
+};
 
-    registerFunctions();
+/* Every function's result, for the comparison with -G */
+static struct func_result func_results[MAX_TRANS_FUNCS];
 
-    /* Open the complete trace file */
-    FILE* full_trace_fp;
-    FILE* part_trace_fp;
+/* Addresses tracegen records in .marker */
+struct markers {
+    unsigned long long start, end;      /* MARKER_START and MARKER_END */
+    unsigned long long lo[KERNEL_OPERANDS]; /* bytes of each operand, */
+    unsigned long long hi[KERNEL_OPERANDS]; /* both 0 if it is unused */
+};
 
-    /* Evaluate the performance of each registered transpose function */
+/*
+ * read_markers - Read the marker file into m. Returns 0 if tracegen has not
+ *     written it (completely) yet.
+ */
+static int read_markers(const char* marker_file, struct markers* m) {
+    int n;
+    FILE* marker_fp = fopen(marker_file, "r");
+    if (marker_fp == NULL)
+        return 0;
+    n = fscanf(marker_fp, "%llx %llx %llx %llx %llx %llx %llx %llx", &m->start, &m->end,
+               &m->lo[0], &m->hi[0], &m->lo[1], &m->hi[1], &m->lo[2], &m->hi[2]);
+    fclose(marker_fp);
+    return n == 8;
+}
 
-    for (i = 0; i < func_counter; i++) {
-        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
-            results.funcid = i;  /* remember which function is the submission */
+/*
+ * print_site - Print the counts charged to one instruction, naming the
+ *     function it is in when the symbol is known
+ */
+static void print_site(const memtrace_site_t* site) {
+    char label[160];
+    Dl_info info;
+
+    if (dladdr(site->pc, &info) && info.dli_sname != NULL)
+        snprintf(label, sizeof(label), "  pc %p (%s+0x%lx)", site->pc, info.dli_sname,
+                 (unsigned long) ((char*) site->pc - (char*) info.dli_saddr));
+    else
+        snprintf(label, sizeof(label), "  pc %p", site->pc);
+    cachesim_print_counts(label, &site->counts);
+}
 
+/*
+ * in_operand - Report whether addr falls in one of the operands in m
+ */
+static int in_operand(const struct markers* m, unsigned long long addr) {
+    int k;
 
-        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n", i, func_counter);
-        /* Use valgrind to generate the trace */
+    for (k = 0; k < KERNEL_OPERANDS; k++)
+        if (addr >= m->lo[k] && addr < m->hi[k])
+            return 1;
+    return 0;
+}
 
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N, i);
-        flag = WEXITSTATUS(system(cmd));
-        if (0 != flag) {
-            printf("Validation error at function %d with error %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n", i, flag, M, N, i);
+/*
+ * eval_lackey - Validate function i and count its hits, misses and evictions
+ *     by tracing ./tracegen under valgrind's lackey tool and replaying the
+ *     trace through ./csim. Returns 0 on a validation error.
+ *
+ * The lackey output is filtered as it streams out of valgrind: only the
+ * accesses to the operands between the two markers are kept, and they go
+ * straight to a binary trace (see bintrace.h) instead of a text file,
+ * flagged so that ./csim counts them as csim-ref would the lackey trace.
+ * Every file involved is private to function i, so several functions can
+ * be evaluated at once.
+ */
+static int eval_lackey(int i, unsigned int s, unsigned int E, unsigned int b,
+                       struct func_result* r) {
+    /* The stride prefetcher needs the instructions as much as -A does */
+    int want_pc = attribute || prefetch == CACHESIM_PREFETCH_STRIDE;
+    int flag, have_markers = 0, k;
+    unsigned int len, pc_len = 0;
+    unsigned long long int addr, pc = 0, written_pc = 0;
+    struct markers m;
+    char buf[1000], cmd[512];
+    char filename[128], marker_file[128];
+    FILE* lackey_fp;
+    FILE* csim_fp;
+    bintrace_t* part_trace;
+
+    /* Use valgrind to generate the trace */
+    sprintf(marker_file, ".marker.f%d", i);
+    remove(marker_file);
+    sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d -R %llu -s %u -b %u -m %s%s%s%s%s%s", M, N, i, seed, s, b, marker_file, use_simd ? " -S" : "", use_oblivious ? " -P" : "", use_inplace ? " -I" : "", use_typed ? " -T" : "", use_kernels ? " -K" : "");
+    lackey_fp = popen(cmd, "r");
+    assert(lackey_fp);
+
+    /* Filtered trace for each transpose function goes in a separate file */
+    sprintf(filename, "trace.f%d", i);
+    part_trace = bintrace_open_write(filename, BINTRACE_FIRST_BYTE);
+    assert(part_trace);
+
+    /* Locate trace corresponding to the trans function */
+    flag = 0;
+    while (fgets(buf, 1000, lackey_fp) != NULL) {
+        /* Instruction lines say which code the accesses after them are from */
+        if (want_pc && buf[0] == 'I') {
+            sscanf(buf + 1, "%llx,%u", &pc, &pc_len);
             continue;
         }
 
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
+        /* We are only interested in memory access instructions */
+        if (buf[0] == ' ' && buf[2] == ' ' &&
+            (buf[1] == 'S' || buf[1] == 'M' || buf[1] == 'L')) {
+            sscanf(buf+3, "%llx,%u", &addr, &len);
+
+            /* tracegen writes .marker before it touches MARKER_START,
+               which is a one-byte store */
+            if (!have_markers) {
+                if (buf[1] != 'S' || len != 1 || !read_markers(marker_file, &m))
+                    continue;
+                have_markers = 1;
+            }
 
+            /* If start marker found, set flag */
+            if (addr == m.start)
+                flag = 1;
 
-        func_list[i].correct = 1;
+            /* Keep only the accesses to the operands, which leaves out the
+               stack and the spurious accesses valgrind creates there */
+            if (flag && in_operand(&m, addr)) {
+                if (want_pc && pc != written_pc) {
+                    bintrace_write(part_trace, 'I', pc, pc_len);
+                    written_pc = pc;
+                }
+                bintrace_write(part_trace, buf[1], addr, len);
+            }
 
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i) {
-            results.correct = 1;
+            /* if end marker found, stop recording */
+            if (addr == m.end)
+                flag = 0;
         }
+    }
+    bintrace_close(part_trace);
+    remove(marker_file);
 
-        full_trace_fp = fopen("trace.tmp", "r");
-        assert(full_trace_fp);
-
-
-        /* Filtered trace for each transpose function goes in a separate file */
-        sprintf(filename, "trace.f%d", i);
-        part_trace_fp = fopen(filename, "w");
-        assert(part_trace_fp);
-
-        /* Locate trace corresponding to the trans function */
-        flag = 0;
-        while (fgets(buf, 1000, full_trace_fp) != NULL) {
-            /* We are only interested in memory access instructions */
-            if (buf[0] == ' ' && buf[2] == ' ' &&
-                (buf[1] == 'S' || buf[1] == 'M' || buf[1] == 'L')) {
-                sscanf(buf+3, "%llx,%u", &addr, &len);
-
-                /* If start marker found, set flag */
-                if (addr == marker_start)
-                    flag = 1;
-
-                /* Valgrind creates many spurious accesses to the
-                   stack that have nothing to do with the students
-                   code. At the moment, we are ignoring all stack
-                   accesses by using the simple filter of recording
-                   accesses to only the low 32-bit portion of the
-                   address space. At some point it would be nice to
-                   try to do more informed filtering so that would
-                   eliminate the valgrind stack references while
-                   include the student stack references. */
-                if (flag && addr < 0xffffffff) {
-                    fputs(buf, part_trace_fp);
-                }
+    flag = WEXITSTATUS(pclose(lackey_fp));
+    if (0 != flag) {
+        printf("Validation error at function %d with error %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n", i, flag, M, N, i);
+        return 0;
+    }
 
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
-                    flag = 0;
-                    fclose(part_trace_fp);
-                    break;
-                }
+    /* Run the reference simulator and collect the summary it prints */
+    printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
+    sprintf(cmd, "./csim -s %u -E %u -b %u -f %s -t trace.f%d", s, E, b,
+            prefetch_name, i);
+    if (attribute) {
+        strcat(cmd, " -A");
+        for (k = 0; k < KERNEL_OPERANDS; k++)
+            if (m.hi[k] > m.lo[k])
+                sprintf(cmd + strlen(cmd), " -r %s:%llx:%llx",
+                        kernel_operand_name(&func_list[i], k), m.lo[k], m.hi[k]);
+    }
+    csim_fp = popen(cmd, "r");
+    assert(csim_fp);
+    flag = 0;
+    if (attribute)
+        printf("Miss breakdown:\n");
+    while (fgets(buf, 1000, csim_fp) != NULL) {
+        if (sscanf(buf, "hits:%u misses:%u evictions:%u", &r->hits, &r->misses,
+                   &r->evictions) == 3)
+            flag = 1;
+        else if (sscanf(buf, "L1 prefetches:%llu useful:%llu", &r->prefetches,
+                        &r->prefetch_hits) == 2)
+            ;
+        else if (attribute && strstr(buf, ": hits:") != NULL)
+            printf("  %s", buf);
+    }
+    pclose(csim_fp);
+    assert(flag);
+    return 1;
+}
+
+/*
+ * print_breakdown - Print the misses of the last run of function i by 3C
+ *     class, by operand, and by the instructions with the most misses
+ */
+static void print_breakdown(int i, cache_sim_t* sim) {
+    memtrace_site_t sites[TOP_SITES];
+    cache_stats_t counts;
+    char label[16];
+    int k, n, range = 0;
+
+    printf("Miss breakdown:\n");
+    cachesim_stats(sim, 0, &counts);
+    cachesim_print_counts("  all", &counts);
+    for (k = 0; k < KERNEL_OPERANDS; k++) {
+        if (kernel_operand_name(&func_list[i], k) == NULL)
+            continue;
+        snprintf(label, sizeof(label), "  %s", kernel_operand_name(&func_list[i], k));
+        memtrace_range_counts(range++, &counts);
+        cachesim_print_counts(label, &counts);
+    }
+    n = memtrace_sites(sites, TOP_SITES);
+    for (k = 0; k < n; k++)
+        print_site(&sites[k]);
+}
+
+/*
+ * eval_sim - Validate function i and count its hits, misses and evictions
+ *     by running it in-process against the cache model, with every access
+ *     it makes to its operands reported through the memtrace hooks. Returns
+ *     0 on a validation error.
+ */
+static int eval_sim(int i, cache_sim_t* sim, struct func_result* res) {
+    size_t len[KERNEL_OPERANDS];
+    kernel_mismatch_t bad;
+    cache_stats_t counts;
+    int k;
+
+    kernel_operands(&func_list[i], M, N, len);
+    kernel_init(&func_list[i], M, N, ops);
+
+    cachesim_reset(sim);
+    memtrace_begin(sim);
+    for (k = 0; k < KERNEL_OPERANDS; k++)
+        if (len[k] > 0)
+            memtrace_add_range(ops[k], sizeof(int) * len[k]);
+    kernel_run(&func_list[i], M, N, ops);
+    memtrace_end();
+
+    if (!kernel_check(&func_list[i], M, N, ops, &bad)) {
+        printf("Validation error at function %d! Expected %d but got %d at %s\nSkipping performance evaluation for this function.\n",
+               i, bad.expected, bad.got, bad.where);
+        return 0;
+    }
+
+    printf("Step 2: Evaluating performance in-process\n");
+    cachesim_results(sim, &res->hits, &res->misses, &res->evictions);
+    cachesim_stats(sim, 0, &counts);
+    res->prefetches = counts.prefetches;
+    res->prefetch_hits = counts.prefetch_hits;
+    if (attribute)
+        print_breakdown(i, sim);
+    return 1;
+}
+
+/*
+ * replay_matches - Record function i with ./tracegen -B, replay the trace
+ *     through ./csim, and check that it counts what the in-process model
+ *     counted in *r
+ */
+static int replay_matches(int i, unsigned int s, unsigned int E, unsigned int b,
+                          const struct func_result* r) {
+    unsigned int hits, misses, evictions;
+    char buf[1000], cmd[512];
+    FILE* csim_fp;
+    int found = 0;
+
+    sprintf(cmd, "./tracegen -M %d -N %d -F %d -R %llu -s %u -b %u -B trace.f%d%s%s%s%s%s",
+            M, N, i, seed, s, b, i, use_simd ? " -S" : "", use_oblivious ? " -P" : "",
+            use_inplace ? " -I" : "", use_typed ? " -T" : "", use_kernels ? " -K" : "");
+    if (system(cmd) != 0) {
+        printf("Cross-check: %s failed\n", cmd);
+        return 0;
+    }
+    sprintf(cmd, "./csim -s %u -E %u -b %u -f %s -t trace.f%d", s, E, b,
+            prefetch_name, i);
+    csim_fp = popen(cmd, "r");
+    assert(csim_fp);
+    while (fgets(buf, sizeof(buf), csim_fp) != NULL)
+        if (sscanf(buf, "hits:%u misses:%u evictions:%u", &hits, &misses,
+                   &evictions) == 3)
+            found = 1;
+    pclose(csim_fp);
+    if (!found) {
+        printf("Cross-check: %s printed no summary\n", cmd);
+        return 0;
+    }
+    if (hits != r->hits || misses != r->misses || evictions != r->evictions) {
+        printf("Cross-check: replayed hits:%u misses:%u evictions:%u differ from in-process\n",
+               hits, misses, evictions);
+        return 0;
+    }
+    printf("Cross-check: replayed counts agree\n");
+    return 1;
+}
+
+/*
+ * eval_func - Validate and evaluate function i, using sim unless -L was given
+ */
+static void eval_func(int i, unsigned int s, unsigned int E, unsigned int b,
+                      cache_sim_t* sim, struct func_result* r) {
+    printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n", i, func_counter);
+    memset(r, 0, sizeof(*r));
+    if (use_lackey)
+        r->correct = eval_lackey(i, s, E, b, r);
+    else
+        r->correct = eval_sim(i, sim, r);
+    if (cross_check && !use_lackey && r->correct)
+        r->replay_differs = !replay_matches(i, s, E, b, r);
+}
+
+/*
+ * record_result - Save the result of function i in func_list, and in
+ *     results if it is the submission
+ */
+static void record_result(int i, const struct func_result* r) {
+    func_results[i] = *r;
+    if (!r->correct)
+        return;
+
+    func_list[i].correct = 1;
+
+    /* Save the correctness of the transpose submission */
+    if (results.funcid == i) {
+        results.correct = 1;
+    }
+
+    func_list[i].num_hits = r->hits;
+    func_list[i].num_misses = r->misses;
+    func_list[i].num_evictions = r->evictions;
+    printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
+           i, func_list[i].description, r->hits, r->misses, r->evictions);
+    if (prefetch != CACHESIM_PREFETCH_NONE)
+        printf("func %u (%s): prefetches:%llu, useful:%llu\n",
+               i, func_list[i].description, r->prefetches, r->prefetch_hits);
+
+    /* If it is transpose_submit(), record number of misses */
+    if (results.funcid == i) {
+        results.misses = r->misses;
+    }
+}
+
+/*
+ * eval_parallel - Evaluate the registered functions in up to num_workers
+ *     forked workers at once. Each worker writes its output to a private
+ *     log and sends its func_result back through a pipe; the logs and
+ *     results are then replayed in function order, so the output matches a
+ *     serial run.
+ */
+static void eval_parallel(unsigned int s, unsigned int E, unsigned int b,
+                          cache_sim_t* sim) {
+    pid_t pids[MAX_TRANS_FUNCS];
+    FILE* logs[MAX_TRANS_FUNCS];
+    int fds[MAX_TRANS_FUNCS];
+    int started = 0, finished = 0;
+    int status, c;
+
+    while (finished < func_counter) {
+        /* Keep num_workers functions in flight */
+        while (started < func_counter && started - finished < num_workers) {
+            int i = started++;
+            int pipe_fds[2];
+
+            logs[i] = tmpfile();
+            assert(logs[i]);
+            /* Flush the logs replayed so far, or the worker would repeat them */
+            fflush(stdout);
+            if (pipe(pipe_fds) < 0 || (pids[i] = fork()) < 0) {
+                fprintf(stderr, "Unable to start a worker for function %d\n", i);
+                exit(1);
+            }
+            if (pids[i] == 0) {
+                struct func_result r;
+                close(pipe_fds[0]);
+                dup2(fileno(logs[i]), STDOUT_FILENO);
+                eval_func(i, s, E, b, sim, &r);
+                fflush(stdout);
+                if (write(pipe_fds[1], &r, sizeof(r)) != sizeof(r))
+                    exit(1);
+                exit(0);
+            }
+            close(pipe_fds[1]);
+            fds[i] = pipe_fds[0];
+        }
+
+        /* Collect the oldest worker */
+        {
+            int i = finished++;
+            struct func_result r;
+            int got = read(fds[i], &r, sizeof(r)) == sizeof(r);
+
+            close(fds[i]);
+            waitpid(pids[i], &status, 0);
+            rewind(logs[i]);
+            while ((c = getc(logs[i])) != EOF)
+                putchar(c);
+            fclose(logs[i]);
+
+            /* A worker that died (e.g. on a segfault) already logged why */
+            if (!got || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fflush(stdout);
+                exit(1);
             }
+            record_result(i, &r);
+        }
+    }
+}
+
+/* 
+ * eval_perf - Evaluate the performance of the registered transpose functions
+ */
+void eval_perf(unsigned int s, unsigned int E, unsigned int b) {
+    int i;
+    struct func_result r;
+    cache_sim_t* sim = NULL;
+
+    registerFunctions();
+    if (registerTunedFunctions)
+        registerTunedFunctions();
+    if (use_simd)
+        registerSimdFunctions();
+    if (use_oblivious)
+        registerObliviousFunctions();
+    if (use_inplace)
+        registerInPlaceFunctions();
+    if (use_typed) {
+        registerTypedFunctions();
+        typed_trans_set_cache(1 << b, 1 << (s + b));
+
+        /* Check every element type, tiled for this cache and a usual L1 */
+        typed_failures = typed_trans_check(1 << b, 1 << (s + b))
+                         + typed_trans_check(TYPED_DEFAULT_LINE_BYTES,
+                                             TYPED_DEFAULT_WAY_BYTES);
+        if (typed_failures == 0)
+            printf("Generic kernels: u8, u16, u32 and u64 match correct_trans_*\n");
+    }
+    if (use_kernels) {
+        registerGemmFunctions();
+        registerStencilFunctions();
+        registerMatvecFunctions();
+    }
+
+    if (!use_lackey) {
+        cache_config_t config = { s, E, b, CACHESIM_LRU, 0, prefetch };
+        sim = cachesim_create_hierarchy(&config, 1);
+        assert(sim);
+        if (attribute && !cachesim_classify_misses(sim)) {
+            printf("Error: Unable to allocate the miss classifier\n");
+            exit(1);
+        }
+    }
+
+    /* Remember which function is the submission */
+    for (i = 0; i < func_counter; i++) {
+        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
+            results.funcid = i;
+    }
+
+    /* Evaluate the performance of each registered transpose function */
+    if (num_workers > 1) {
+        eval_parallel(s, E, b, sim);
+    } else {
+        for (i = 0; i < func_counter; i++) {
+            eval_func(i, s, E, b, sim, &r);
+            record_result(i, &r);
+        }
+    }
+    cachesim_free(sim);
+}
+
+/*
+ * last_occurrence - The last place needle occurs in haystack, or NULL
+ */
+static const char* last_occurrence(const char* haystack, const char* needle) {
+    const char *found = NULL, *p;
+
+    for (p = strstr(haystack, needle); p != NULL; p = strstr(p + 1, needle))
+        found = p;
+    return found;
+}
+
+/*
+ * eval_native - Time every function with ./time-trans on native_size x
+ *     native_size matrices, and print its bandwidth beside the miss rate
+ *     and misses the cache model gave it
+ *
+ * Descriptions may contain "): " themselves (autotune's do), so each line's
+ * description runs up to the last one. It must be the one test-trans has
+ * for that function number: a ./time-trans built with a different set of
+ * kernels would otherwise put every timing on the wrong row.
+ */
+static void eval_native(void) {
+    double gbps[MAX_TRANS_FUNCS];
+    int timed[MAX_TRANS_FUNCS] = { 0 };
+    int rows[MAX_TRANS_FUNCS], cols[MAX_TRANS_FUNCS];
+    char size[32];
+    char buf[1000], cmd[255];
+    const char *desc, *rest;
+    FILE* time_fp;
+    int i, mismatched = 0;
+
+    printf("\nTiming each function natively on %dx%d matrices\n", native_size, native_size);
+    fflush(stdout);
+    sprintf(cmd, "./time-trans -M %d -N %d -R %llu%s%s%s%s%s", native_size, native_size,
+            seed, use_simd ? " -S" : "", use_oblivious ? " -P" : "", use_inplace ? " -I" : "",
+            use_typed ? " -T" : "", use_kernels ? " -K" : "");
+    time_fp = popen(cmd, "r");
+    assert(time_fp);
+    while (fgets(buf, sizeof(buf), time_fp) != NULL) {
+        if (sscanf(buf, "func %d", &i) != 1 || i < 0 || i >= func_counter)
+            continue;
+        desc = strchr(buf, '(');
+        rest = last_occurrence(buf, "): ");
+        if (desc == NULL || rest == NULL || desc > rest)
+            continue;
+        desc++;
+        if (strlen(func_list[i].description) != (size_t) (rest - desc)
+            || strncmp(desc, func_list[i].description, rest - desc) != 0) {
+            printf("Error: ./time-trans has func %d as \"%.*s\", not \"%s\"\n",
+                   i, (int) (rest - desc), desc, func_list[i].description);
+            mismatched = 1;
+            continue;
         }
-        fclose(full_trace_fp);
-
-        /* Run the reference simulator */
-        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./support/csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null",
-                s, E, b, i);
-        system(cmd);
-
-        /* Collect results from the reference simulator */
-        FILE* in_fp = fopen(".csim_results", "r");
-        assert(in_fp);
-        fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
-        fclose(in_fp);
-        func_list[i].num_hits = hits;
-        func_list[i].num_misses = misses;
-        func_list[i].num_evictions = evictions;
-        printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
-               i, func_list[i].description, hits, misses, evictions);
-
-        /* If it is transpose_submit(), record number of misses */
-        if (results.funcid == i) {
-            results.misses = misses;
+        if (sscanf(rest, "): %lf GB/s on %dx%d", &gbps[i], &rows[i], &cols[i]) == 3)
+            timed[i] = 1;
+    }
+    if (WEXITSTATUS(pclose(time_fp)) != 0) {
+        printf("Error: ./time-trans failed\n");
+        return;
+    }
+    if (mismatched) {
+        printf("Error: ./time-trans registers different functions; rebuild it with make\n");
+        return;
+    }
+
+    printf("\nSimulated misses (%dx%d, prefetcher %s) vs. measured bandwidth:\n",
+           M, N, prefetch_name);
+    printf("%4s %-9s %10s %9s %10s %8s %9s %11s  %s\n", "func", "kind", "misses",
+           "miss rate", "prefetches", "useful", "GB/s", "timed on", "description");
+    for (i = 0; i < func_counter; i++) {
+        struct func_result* r = &func_results[i];
+        unsigned int accesses = r->hits + r->misses;
+
+        printf("%4d %-9s ", i, kernel_kind_name(&func_list[i]));
+        if (r->correct)
+            printf("%10u %8.2f%% %10llu %8llu ", r->misses,
+                   accesses ? 100.0 * r->misses / accesses : 0.0, r->prefetches,
+                   r->prefetch_hits);
+        else
+            printf("%10s %9s %10s %8s ", "-", "-", "-", "-");
+        if (timed[i]) {
+            snprintf(size, sizeof(size), "%dx%d", rows[i], cols[i]);
+            printf("%9.3f %11s  %s\n", gbps[i], size, func_list[i].description);
+        } else {
+            printf("%9s %11s  %s\n", "-", "-", func_list[i].description);
         }
     }
 }
@@ -161,11 +640,24 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b) {
  * usage - Print usage info
  */
 void usage(char *argv[]) {
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-hLSPITKAC] [-j <workers>] [-f <prefetcher>] [-G <size>] [-R <seed>] -M <rows> -N <cols>\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
-    printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
-    printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
+    printf("  -L          Trace with valgrind and simulate with ./csim.\n");
+    printf("  -j <n>      Evaluate up to n functions at once (0: one per CPU).\n");
+    printf("  -S          Also evaluate the SIMD transposes in simd-trans.c.\n");
+    printf("  -P          Also evaluate the cache-oblivious transposes.\n");
+    printf("  -I          Also evaluate the in-place transposes.\n");
+    printf("  -T          Also evaluate the element-size-generic transposes, and\n");
+    printf("              check them for every element type on odd-stride views.\n");
+    printf("  -K          Also evaluate the GEMM, stencil and matrix-vector kernels.\n");
+    printf("  -A          Break misses down by 3C class, matrix and instruction.\n");
+    printf("  -C          Check the counts against ./tracegen -B and ./csim.\n");
+    printf("  -f <name>   Prefetcher in the cache model: none (default), next, stride.\n");
+    printf("  -G <size>   Also time each function natively on size x size matrices.\n");
+    printf("  -R <seed>   Seed the matrix contents (default %#llx).\n", CACHELAB_DEFAULT_SEED);
+    printf("  -M <rows>   Number of matrix rows\n");
+    printf("  -N <cols>   Number of  matrix columns\n");
     printf("Example: %s -M 8 -N 8\n", argv[0]);
 }
 
@@ -193,9 +685,11 @@ void sigalrm_handler(int signum) {
  * main - Main routine
  */
 int main(int argc, char* argv[]) {
+    size_t len[KERNEL_OPERANDS];
+    int k;
     char c;
 
-    while ((c = getopt(argc, argv, "M:N:h")) != -1) {
+    while ((c = getopt(argc, argv, "M:N:hLSPITKACj:f:G:R:")) != -1) {
         switch (c) {
         case 'M':
             M = atoi(optarg);
@@ -206,6 +700,50 @@ int main(int argc, char* argv[]) {
         case 'h':
             usage(argv);
             exit(0);
+        case 'L':
+            use_lackey = 1;
+            break;
+        case 'S':
+            use_simd = 1;
+            break;
+        case 'P':
+            use_oblivious = 1;
+            break;
+        case 'I':
+            use_inplace = 1;
+            break;
+        case 'T':
+            use_typed = 1;
+            break;
+        case 'K':
+            use_kernels = 1;
+            break;
+        case 'A':
+            attribute = 1;
+            break;
+        case 'C':
+            cross_check = 1;
+            break;
+        case 'f':
+            if (cachesim_parse_prefetch(optarg) < 0) {
+                printf("Error: Unknown prefetcher '%s'\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            prefetch = (cache_prefetch_t) cachesim_parse_prefetch(optarg);
+            prefetch_name = optarg;
+            break;
+        case 'G':
+            native_size = atoi(optarg);
+            break;
+        case 'R':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'j':
+            num_workers = atoi(optarg);
+            if (num_workers <= 0)
+                num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+            break;
         default:
             usage(argv);
             exit(1);
@@ -218,12 +756,19 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
-    if (M > MAXN || N > MAXN) {
-        printf("Error: M or N exceeds %d\n", MAXN);
+    if (M < 0 || N < 0) {
+        printf("Error: M and N must be positive\n");
         usage(argv);
         exit(1);
     }
 
+    setMatrixSeed(seed);
+    kernel_buffer_sizes(M, N, len);
+    if (allocOperands(KERNEL_OPERANDS, len, ops) == NULL) {
+        printf("Error: Unable to allocate %dx%d matrices\n", M, N);
+        exit(1);
+    }
+
     /* Install SIGSEGV and SIGALRM handlers */
     if (signal(SIGSEGV, sigsegv_handler) == SIG_ERR) {
         fprintf(stderr, "Unable to install SIGALRM handler\n");
@@ -241,6 +786,12 @@ int main(int argc, char* argv[]) {
     /* Check the performance of the student's transpose function */
     eval_perf(5, 1, 5);
 
+    /* Native timing gets a fresh time limit of its own */
+    if (native_size > 0) {
+        alarm(120);
+        eval_native();
+    }
+
     /* Emit the results for this particular test */
     if (results.funcid == -1) {
         printf("\nError: We could not find your transpose_submit() function\n");
@@ -252,5 +803,14 @@ int main(int argc, char* argv[]) {
                results.funcid, results.correct, results.misses);
         printf("\nTEST_TRANS_RESULTS=%d:%d\n", results.correct, results.misses);
     }
+    if (typed_failures > 0) {
+        printf("Error: %d generic kernel checks failed\n", typed_failures);
+        return 1;
+    }
+    for (k = 0; k < func_counter; k++)
+        if (func_results[k].replay_differs) {
+            printf("Error: Function %d counts differently replayed through ./csim\n", k);
+            return 1;
+        }
     return 0;
 }
@@ -0,0 +1,257 @@
+/*
+ * threadpool.c - The work-stealing pool described in threadpool.h.
+ *
+ * Deques are fixed-size rings guarded by a mutex each. That is simpler
+ * than a lock-free Chase-Lev deque and cheap enough here, since a task is
+ * a whole transpose subproblem rather than a few instructions. Idle workers
+ * sleep on a condition variable until the number of queued tasks becomes
+ * nonzero.
+ */
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "threadpool.h"
+
+#define DEQUE_SIZE 1024
+
+typedef struct task {
+    void (*fn)(void*);
+    void* arg;
+    tpool_group_t* group;
+} task_t;
+
+typedef struct deque {
+    pthread_mutex_t lock;
+    task_t tasks[DEQUE_SIZE];
+    unsigned long top;              /* next task to steal */
+    unsigned long bottom;           /* one past the newest task */
+} deque_t;
+
+struct tpool {
+    int nthreads;
+    pthread_t* threads;
+    deque_t* deques;                /* one per worker, plus one shared by outside threads */
+    atomic_int queued;              /* tasks sitting in any deque */
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    int shutdown;
+};
+
+/* Index of this thread's deque in the pool it works for, -1 outside pools */
+static _Thread_local int worker_id = -1;
+
+typedef struct worker_start {
+    tpool_t* pool;
+    int id;
+} worker_start_t;
+
+/*
+ * my_deque - The deque the calling thread pushes to and pops from
+ */
+static deque_t* my_deque(tpool_t* pool) {
+    return &pool->deques[worker_id >= 0 ? worker_id : pool->nthreads];
+}
+
+/*
+ * pop_bottom - Take the newest task of d. Returns 0 if it is empty.
+ */
+static int pop_bottom(tpool_t* pool, deque_t* d, task_t* task) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom != d->top) {
+        d->bottom--;
+        *task = d->tasks[d->bottom % DEQUE_SIZE];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (found)
+        atomic_fetch_sub(&pool->queued, 1);
+    return found;
+}
+
+/*
+ * steal_top - Take the oldest task of d. Returns 0 if it is empty.
+ */
+static int steal_top(tpool_t* pool, deque_t* d, task_t* task) {
+    int found = 0;
+    if (pthread_mutex_trylock(&d->lock) != 0)
+        return 0;
+    if (d->bottom != d->top) {
+        *task = d->tasks[d->top % DEQUE_SIZE];
+        d->top++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (found)
+        atomic_fetch_sub(&pool->queued, 1);
+    return found;
+}
+
+/*
+ * find_task - Pop from our own deque, else steal from the others, starting
+ *     after our own so thieves spread out
+ */
+static int find_task(tpool_t* pool, task_t* task) {
+    int n = pool->nthreads + 1;
+    int self = worker_id >= 0 ? worker_id : pool->nthreads;
+    int i;
+
+    if (pop_bottom(pool, &pool->deques[self], task))
+        return 1;
+    for (i = 1; i < n; i++) {
+        if (steal_top(pool, &pool->deques[(self + i) % n], task))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * run_task - Run a task and mark it done in its group
+ */
+static void run_task(task_t* task) {
+    task->fn(task->arg);
+    atomic_fetch_sub(&task->group->pending, 1);
+}
+
+/*
+ * worker_main - Run tasks until the pool shuts down, sleeping when there
+ *     are none
+ */
+static void* worker_main(void* arg) {
+    worker_start_t* start = arg;
+    tpool_t* pool = start->pool;
+    task_t task;
+
+    worker_id = start->id;
+    free(start);
+
+    for (;;) {
+        if (find_task(pool, &task)) {
+            run_task(&task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->idle_lock);
+        while (!pool->shutdown && atomic_load(&pool->queued) == 0)
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->idle_lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+/*
+ * tpool_create - Start nthreads workers
+ */
+tpool_t* tpool_create(int nthreads) {
+    tpool_t* pool;
+    int i;
+
+    if (nthreads < 1)
+        return NULL;
+    pool = calloc(1, sizeof(tpool_t));
+    if (pool == NULL)
+        return NULL;
+    pool->nthreads = nthreads;
+    pool->threads = calloc(nthreads, sizeof(pthread_t));
+    pool->deques = calloc(nthreads + 1, sizeof(deque_t));
+    if (pool->threads == NULL || pool->deques == NULL) {
+        free(pool->threads);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    for (i = 0; i <= nthreads; i++)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    atomic_init(&pool->queued, 0);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+
+    for (i = 0; i < nthreads; i++) {
+        worker_start_t* start = malloc(sizeof(worker_start_t));
+        if (start != NULL) {
+            start->pool = pool;
+            start->id = i;
+        }
+        if (start == NULL || pthread_create(&pool->threads[i], NULL, worker_main, start) != 0) {
+            free(start);
+            pool->nthreads = i;
+            tpool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+/*
+ * tpool_destroy - Wake every worker, wait for them to exit and free the pool
+ */
+void tpool_destroy(tpool_t* pool) {
+    int i;
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+    for (i = 0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    for (i = 0; i <= pool->nthreads; i++)
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool->threads);
+    free(pool->deques);
+    free(pool);
+}
+
+/*
+ * tpool_size - Report the number of workers
+ */
+int tpool_size(tpool_t* pool) {
+    return pool->nthreads;
+}
+
+/*
+ * tpool_spawn - Push fn(arg) onto the calling thread's deque and wake a
+ *     sleeping worker
+ */
+void tpool_spawn(tpool_t* pool, tpool_group_t* group, void (*fn)(void*), void* arg) {
+    deque_t* d = my_deque(pool);
+    task_t task = { fn, arg, group };
+    int pushed = 0;
+
+    atomic_fetch_add(&group->pending, 1);
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top < DEQUE_SIZE) {
+        d->tasks[d->bottom % DEQUE_SIZE] = task;
+        d->bottom++;
+        /* Count it before anyone can take it, so queued never goes negative */
+        atomic_fetch_add(&pool->queued, 1);
+        pushed = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    if (!pushed) {
+        run_task(&task);
+        return;
+    }
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_signal(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+/*
+ * tpool_wait - Help run tasks until group has none left
+ */
+void tpool_wait(tpool_t* pool, tpool_group_t* group) {
+    task_t task;
+
+    while (atomic_load(&group->pending) > 0) {
+        if (find_task(pool, &task))
+            run_task(&task);
+        else
+            sched_yield();
+    }
+}
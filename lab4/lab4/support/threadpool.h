@@ -0,0 +1,41 @@
+/*
+ * threadpool.h - A small work-stealing thread pool for fork-join
+ *     recursion. Every worker owns a deque: it pushes and pops its own tasks
+ *     at the bottom (newest first, for locality) and steals from the top of
+ *     other workers' deques (oldest first, i.e. the biggest subproblems)
+ *     when it runs out. Threads outside the pool share one extra deque.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdatomic.h>
+
+typedef struct tpool tpool_t;
+
+/* Tasks spawned into the same group are waited for together */
+typedef struct tpool_group {
+    atomic_int pending;
+} tpool_group_t;
+
+#define TPOOL_GROUP_INIT { 0 }
+
+/* Start a pool of nthreads workers. Returns NULL on failure. */
+tpool_t* tpool_create(int nthreads);
+
+/* Stop the workers and free the pool; it must have no pending tasks */
+void tpool_destroy(tpool_t* pool);
+
+/* Number of workers in the pool */
+int tpool_size(tpool_t* pool);
+
+/* Queue fn(arg) as part of group. Runs it right away if the deque is full. */
+void tpool_spawn(tpool_t* pool, tpool_group_t* group, void (*fn)(void*), void* arg);
+
+/*
+ * Wait until every task spawned into group has finished, running queued
+ * tasks (the group's or others') in the meantime rather than blocking.
+ */
+void tpool_wait(tpool_t* pool, tpool_group_t* group);
+
+#endif /* THREADPOOL_H */
@@ -0,0 +1,74 @@
+/*
+ * tiled.c - The parameterized blocked transpose behind ./autotune and
+ *     trans-tuned.c. Loop counters and the row buffer live on the stack,
+ *     which the cache model does not trace, the same way it treats a
+ *     transpose's local variables as registers.
+ */
+#include <stdio.h>
+#include "tiled.h"
+
+/*
+ * trans_tile_row - Transpose A[i][j0..j1) into column i of B
+ */
+static void trans_tile_row(const tile_params_t* p, int M, int N,
+                           int A[M][N], int B[N][M], int i, int j0, int j1) {
+    int row[TILE_MAX_BUFFERED];
+    int j, diag = 0, have_diag = 0;
+
+    if (p->buffer_rows && j1 - j0 <= TILE_MAX_BUFFERED) {
+        /* All loads from A's row happen before any store to B */
+        for (j = j0; j < j1; j++)
+            row[j - j0] = A[i][j];
+        for (j = j0; j < j1; j++) {
+            if (p->defer_diagonal && j == i)
+                continue;
+            B[j][i] = row[j - j0];
+        }
+        if (p->defer_diagonal && i >= j0 && i < j1)
+            B[i][i] = row[i - j0];
+        return;
+    }
+
+    for (j = j0; j < j1; j++) {
+        if (p->defer_diagonal && j == i) {
+            diag = A[i][j];
+            have_diag = 1;
+            continue;
+        }
+        B[j][i] = A[i][j];
+    }
+    if (have_diag)
+        B[i][i] = diag;
+}
+
+/*
+ * tiled_trans - B = A^T, one tile_rows x tile_cols tile of A at a time
+ */
+void tiled_trans(const tile_params_t* p, int M, int N, int A[M][N], int B[N][M]) {
+    int ii, jj, i;
+    int outer_end = p->col_major ? N : M;
+    int outer_step = p->col_major ? p->tile_cols : p->tile_rows;
+    int inner_end = p->col_major ? M : N;
+    int inner_step = p->col_major ? p->tile_rows : p->tile_cols;
+    int outer, inner;
+
+    for (outer = 0; outer < outer_end; outer += outer_step) {
+        for (inner = 0; inner < inner_end; inner += inner_step) {
+            ii = p->col_major ? inner : outer;
+            jj = p->col_major ? outer : inner;
+            for (i = ii; i < ii + p->tile_rows && i < M; i++)
+                trans_tile_row(p, M, N, A, B, i, jj,
+                               jj + p->tile_cols < N ? jj + p->tile_cols : N);
+        }
+    }
+}
+
+/*
+ * tile_params_describe - Write a short description of p into buf
+ */
+void tile_params_describe(const tile_params_t* p, char* buf, size_t len) {
+    snprintf(buf, len, "%dx%d tiles, %s%s%s", p->tile_rows, p->tile_cols,
+             p->col_major ? "column-major" : "row-major",
+             p->defer_diagonal ? ", deferred diagonal" : "",
+             p->buffer_rows ? ", buffered rows" : "");
+}
@@ -0,0 +1,30 @@
+/*
+ * tiled.h - A blocked transpose parameterized by tile shape, tile order,
+ *     diagonal handling and register buffering. ./autotune searches these
+ *     parameters against the cache model and emits the best setting as a
+ *     registered function in trans-tuned.c.
+ */
+
+#ifndef TILED_H
+#define TILED_H
+
+#include <stddef.h>
+
+/* Largest tile width whose rows can be buffered in locals */
+#define TILE_MAX_BUFFERED 16
+
+typedef struct tile_params {
+    int tile_rows;          /* rows of A per tile */
+    int tile_cols;          /* columns of A per tile */
+    int col_major;          /* visit tiles down the columns of A, not along its rows */
+    int defer_diagonal;     /* store A[i][i] after the rest of its tile row */
+    int buffer_rows;        /* load a whole tile row of A before storing it */
+} tile_params_t;
+
+/* B = A^T, tile by tile as described by p */
+void tiled_trans(const tile_params_t* p, int M, int N, int A[M][N], int B[N][M]);
+
+/* Write a short description of p, e.g. "8x4 tiles, row-major, buffered" */
+void tile_params_describe(const tile_params_t* p, char* buf, size_t len);
+
+#endif /* TILED_H */
@@ -0,0 +1,211 @@
+/*
+ * time-trans.c - Times the registered functions on this machine.
+ *     The Makefile links it against copies of the kernels built with -O2
+ *     and without the memtrace hooks, so the times are those of ordinary
+ *     compiled code. Functions are registered in the same order as in
+ *     test-trans and tracegen, so the function numbers agree; test-trans -G
+ *     runs it to set measured bandwidth beside simulated misses.
+ *
+ * Each function is checked once, then run until TIME_BUDGET_NS has passed
+ * (at least MIN_RUNS times), and its fastest run is reported as GB/s of
+ * operand traffic, every element of every operand touched once (see
+ * kernel_bytes()). For a transpose that is 2 * sizeof(int) * M * N bytes;
+ * for GEMM, whose work grows faster than its operands, it is more of a
+ * throughput scale than a bandwidth. GEMM also runs on at most
+ * MAX_GEMM_SIZE rows and columns, since its work (and its reference
+ * check's) grows with the cube of the size.
+ */
+#define _POSIX_C_SOURCE 200809L  /* for clock_gettime() under -std=c18 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "cachelab.h"
+#include "simd-trans.h"
+#include "oblivious-trans.h"
+#include "inplace-trans.h"
+#include "typed-trans.h"
+#include "gemm.h"
+#include "stencil.h"
+#include "matvec.h"
+#include "kernels.h"
+
+/* Timed runs per function: at least MIN_RUNS, then until the budget is spent */
+#define MIN_RUNS 3
+#define TIME_BUDGET_NS 250000000LL
+
+/* Largest M and N a GEMM kernel is timed on */
+#define MAX_GEMM_SIZE 512
+
+/* External function defined in trans.c */
+extern void registerFunctions();
+
+/* Defined in trans-tuned.c, if ./autotune has written one */
+extern void registerTunedFunctions() __attribute__((weak));
+
+/* External variables defined in cachelab.c */
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+
+static int M = 0;
+static int N = 0;
+static int* ops[KERNEL_OPERANDS];
+
+/*
+ * now_ns - Monotonic time in nanoseconds
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * run - Run function i once on rows x cols operands, timing just the call.
+ *     In-place transposes get A copied into B again first.
+ */
+static long long run(int i, int rows, int cols) {
+    long long start;
+
+    if (func_list[i].in_place)
+        memcpy(ops[1], ops[0], sizeof(int) * rows * cols);
+    start = now_ns();
+    kernel_run(&func_list[i], rows, cols, ops);
+    return now_ns() - start;
+}
+
+/*
+ * time_func - Check function i, then report its best bandwidth
+ */
+static void time_func(int i) {
+    long long elapsed, best = 0, spent = 0;
+    kernel_mismatch_t bad;
+    int runs, rows = M, cols = N;
+
+    if (func_list[i].kind == KERNEL_GEMM) {
+        rows = rows < MAX_GEMM_SIZE ? rows : MAX_GEMM_SIZE;
+        cols = cols < MAX_GEMM_SIZE ? cols : MAX_GEMM_SIZE;
+    }
+    kernel_init(&func_list[i], rows, cols, ops);
+    run(i, rows, cols);
+    if (!kernel_check(&func_list[i], rows, cols, ops, &bad)) {
+        printf("func %d (%s): incorrect, expected %d but got %d at %s\n", i,
+               func_list[i].description, bad.expected, bad.got, bad.where);
+        return;
+    }
+    for (runs = 0; runs < MIN_RUNS || spent < TIME_BUDGET_NS; runs++) {
+        elapsed = run(i, rows, cols);
+        spent += elapsed;
+        if (runs == 0 || elapsed < best)
+            best = elapsed;
+    }
+    if (best <= 0)
+        best = 1;
+    printf("func %d (%s): %.3f GB/s on %dx%d, best of %d runs\n", i,
+           func_list[i].description, kernel_bytes(&func_list[i], rows, cols) / best,
+           rows, cols, runs);
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[]) {
+    printf("Usage: %s [-hSPITK] [-F <func>] [-R <seed>] -M <rows> -N <cols>\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -F <func>   Time only this function.\n");
+    printf("  -S          Also time the SIMD transposes in simd-trans.c.\n");
+    printf("  -P          Also time the cache-oblivious transposes.\n");
+    printf("  -I          Also time the in-place transposes.\n");
+    printf("  -T          Also time the element-size-generic transposes.\n");
+    printf("  -K          Also time the GEMM, stencil and matrix-vector kernels.\n");
+    printf("  -M <rows>   Number of matrix rows\n");
+    printf("  -N <cols>   Number of matrix columns\n");
+    printf("  -R <seed>   Seed the matrix contents.\n");
+    printf("Example: %s -S -M 4096 -N 4096\n", argv[0]);
+}
+
+int main(int argc, char* argv[]) {
+    int use_simd = 0, use_oblivious = 0, use_inplace = 0, use_typed = 0;
+    int use_kernels = 0, selected = -1, i;
+    size_t len[KERNEL_OPERANDS];
+    char c;
+
+    while ((c = getopt(argc, argv, "hF:SPITKM:N:R:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv);
+            exit(0);
+        case 'F':
+            selected = atoi(optarg);
+            break;
+        case 'S':
+            use_simd = 1;
+            break;
+        case 'P':
+            use_oblivious = 1;
+            break;
+        case 'I':
+            use_inplace = 1;
+            break;
+        case 'T':
+            use_typed = 1;
+            break;
+        case 'K':
+            use_kernels = 1;
+            break;
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 'R':
+            setMatrixSeed(strtoull(optarg, NULL, 0));
+            break;
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (M <= 0 || N <= 0) {
+        printf("Error: M and N must be positive\n");
+        usage(argv);
+        exit(1);
+    }
+
+    registerFunctions();
+    if (registerTunedFunctions)
+        registerTunedFunctions();
+    if (use_simd)
+        registerSimdFunctions();
+    if (use_oblivious)
+        registerObliviousFunctions();
+    if (use_inplace)
+        registerInPlaceFunctions();
+    if (use_typed)
+        registerTypedFunctions();
+    if (use_kernels) {
+        registerGemmFunctions();
+        registerStencilFunctions();
+        registerMatvecFunctions();
+    }
+    if (selected >= func_counter) {
+        printf("Error: There is no function %d\n", selected);
+        exit(1);
+    }
+
+    kernel_buffer_sizes(M, N, len);
+    if (allocOperands(KERNEL_OPERANDS, len, ops) == NULL) {
+        printf("Error: Unable to allocate %dx%d matrices\n", M, N);
+        exit(1);
+    }
+
+    for (i = 0; i < func_counter; i++)
+        if (selected < 0 || i == selected) {
+            time_func(i);
+            fflush(stdout);
+        }
+    return 0;
+}
@@ -4,7 +4,19 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses, and the extent of each operand (A, B and the third operand
+ * GEMM and matrix-vector kernels take, or 0 0 if it is unused), are
+ * recorded in .marker (or the file given with -m) for later use.
+ *
+ * With -B <file>, tracegen instead records the accesses each function
+ * makes to its operands between the markers itself, through the memtrace hooks,
+ * and writes them to file as a binary trace (see bintrace.h) that ./csim
+ * reads directly. No valgrind run is needed.
+ *
+ * -R <seed> seeds the matrix contents (see initMatrix()); test-trans
+ * passes its own seed, so both see the same matrices. -s <bits> and -b <bits>
+ * tile the generic transposes for a cache of 2^s sets of 2^b-byte lines,
+ * as test-trans does for the cache it models.
  */
 
 #include <stdlib.h>
@@ -13,6 +25,16 @@
 #include <unistd.h>
 #include <getopt.h>
 #include "cachelab.h"
+#include "memtrace.h"
+#include "bintrace.h"
+#include "simd-trans.h"
+#include "oblivious-trans.h"
+#include "inplace-trans.h"
+#include "typed-trans.h"
+#include "gemm.h"
+#include "stencil.h"
+#include "matvec.h"
+#include "kernels.h"
 #include <string.h>
 
 /* External variables declared in cachelab.c */
@@ -22,37 +44,68 @@ extern int func_counter;
 /* External function from trans.c */
 extern void registerFunctions();
 
+/* Defined in trans-tuned.c, if ./autotune has written one */
+extern void registerTunedFunctions() __attribute__((weak));
+
 /* Markers used to bound trace regions of interest */
 volatile char MARKER_START, MARKER_END;
 
-static int A[256][256];
-static int B[256][256];
+/* Operands, allocated once M and N are known (see kernels.h) */
+static int* ops[KERNEL_OPERANDS];
 static int M;
 static int N;
+static bintrace_t* trace = NULL;  /* set by -B */
 
 
-int validate(int fn, int M, int N, int A[M][N], int B[N][M]) {
-    int C[N][M];
-    memset(C, 0, sizeof(C));
-    correctTrans(M, N, A, C);
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < M; j++) {
-            if (B[i][j] != C[i][j]) {
-                printf("Validation failed on function %d! Expected %d but got %d at B[%d][%d]\n",
-                       fn, C[i][j], B[i][j], i, j);
-                return 0;
-            }
-        }
+int validate(int fn) {
+    kernel_mismatch_t bad;
+
+    if (!kernel_check(&func_list[fn], M, N, ops, &bad)) {
+        printf("Validation failed on function %d! Expected %d but got %d at %s\n",
+               fn, bad.expected, bad.got, bad.where);
+        return 0;
     }
     return 1;
 }
 
+/*
+ * run_trans - Fill the inputs of function fn and run it between the
+ *     markers, recording its accesses to its operands if a binary trace
+ *     was requested
+ */
+void run_trans(int fn) {
+    size_t len[KERNEL_OPERANDS];
+    int k;
+
+    kernel_operands(&func_list[fn], M, N, len);
+    kernel_init(&func_list[fn], M, N, ops);
+    if (trace != NULL) {
+        memtrace_begin_record(trace);
+        for (k = 0; k < KERNEL_OPERANDS; k++)
+            if (len[k] > 0)
+                memtrace_add_range(ops[k], sizeof(int) * len[k]);
+    }
+    MARKER_START = 33;
+    kernel_run(&func_list[fn], M, N, ops);
+    MARKER_END = 34;
+    if (trace != NULL)
+        memtrace_end();
+}
+
 int main(int argc, char* argv[]) {
-    int i;
+    size_t len[KERNEL_OPERANDS];
+    int i, k;
 
     char c;
     int selectedFunc = -1;
-    while ((c = getopt(argc, argv, "M:N:F:")) != -1) {
+    char* marker_file = ".marker";
+    int use_simd = 0;
+    int use_oblivious = 0;
+    int use_inplace = 0;
+    int use_typed = 0;
+    int use_kernels = 0;
+    int set_bits = 6, block_bits = 6;   /* TYPED_DEFAULT_* */
+    while ((c = getopt(argc, argv, "M:N:F:B:m:R:s:b:SPITK")) != -1) {
         switch (c) {
         case 'M':
             M = atoi(optarg);
@@ -63,6 +116,40 @@ int main(int argc, char* argv[]) {
         case 'F':
             selectedFunc = atoi(optarg);
             break;
+        case 'S':
+            use_simd = 1;
+            break;
+        case 'P':
+            use_oblivious = 1;
+            break;
+        case 'I':
+            use_inplace = 1;
+            break;
+        case 'T':
+            use_typed = 1;
+            break;
+        case 'K':
+            use_kernels = 1;
+            break;
+        case 'm':
+            marker_file = optarg;
+            break;
+        case 'R':
+            setMatrixSeed(strtoull(optarg, NULL, 0));
+            break;
+        case 's':
+            set_bits = atoi(optarg);
+            break;
+        case 'b':
+            block_bits = atoi(optarg);
+            break;
+        case 'B':
+            trace = bintrace_open_write(optarg, 0);
+            if (trace == NULL) {
+                printf("./tracegen could not create %s.\n", optarg);
+                exit(1);
+            }
+            break;
         case '?':
         default:
             printf("./tracegen failed to parse its options.\n");
@@ -73,34 +160,64 @@ int main(int argc, char* argv[]) {
 
     /*  Register transpose functions */
     registerFunctions();
+    if (registerTunedFunctions)
+        registerTunedFunctions();
+    if (use_simd)
+        registerSimdFunctions();
+    if (use_oblivious)
+        registerObliviousFunctions();
+    if (use_inplace)
+        registerInPlaceFunctions();
+    if (use_typed) {
+        registerTypedFunctions();
+        typed_trans_set_cache(1 << block_bits, 1 << (set_bits + block_bits));
+    }
+    if (use_kernels) {
+        registerGemmFunctions();
+        registerStencilFunctions();
+        registerMatvecFunctions();
+    }
 
-    /* Fill A with data */
-    initMatrix(M, N, A, B);
+    if (M <= 0 || N <= 0) {
+        printf("./tracegen needs positive -M and -N.\n");
+        exit(1);
+    }
+    kernel_buffer_sizes(M, N, len);
+    if (allocOperands(KERNEL_OPERANDS, len, ops) == NULL) {
+        printf("./tracegen could not allocate %dx%d matrices.\n", M, N);
+        exit(1);
+    }
 
-    /* Record marker addresses */
-    FILE* marker_fp = fopen(".marker", "w");
+    /* Record marker addresses, and the operands of the selected function
+       (all of them when tracing every function) */
+    FILE* marker_fp = fopen(marker_file, "w");
     assert(marker_fp);
+    if (selectedFunc >= 0 && selectedFunc < func_counter)
+        kernel_operands(&func_list[selectedFunc], M, N, len);
     fprintf(marker_fp, "%llx %llx",
             (unsigned long long int) &MARKER_START,
             (unsigned long long int) &MARKER_END);
+    for (k = 0; k < KERNEL_OPERANDS; k++)
+        if (len[k] > 0)
+            fprintf(marker_fp, " %llx %llx", (unsigned long long int) ops[k],
+                    (unsigned long long int) ops[k] + sizeof(int) * len[k]);
+        else
+            fprintf(marker_fp, " 0 0");
     fclose(marker_fp);
 
     if (-1 == selectedFunc) {
         /* Invoke registered transpose functions */
         for (i = 0; i < func_counter; i++) {
-            MARKER_START = 33;
-            (*func_list[i].func_ptr)(M, N, A, B);
-            MARKER_END = 34;
-            if (!validate(i, M, N, A, B))
+            run_trans(i);
+            if (!validate(i))
                 return i+1;
         }
     } else {
-        MARKER_START = 33;
-        (*func_list[selectedFunc].func_ptr)(M, N, A, B);
-        MARKER_END = 34;
-        if (!validate(selectedFunc, M, N, A, B))
+        run_trans(selectedFunc);
+        if (!validate(selectedFunc))
             return selectedFunc+1;
     }
+    bintrace_close(trace);
     return 0;
 }
 
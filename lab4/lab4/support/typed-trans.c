@@ -0,0 +1,206 @@
+/*
+ * typed-trans.c - The element-size-generic transposes in typed-trans.h
+ */
+#include <stdio.h>
+#include <string.h>
+#include "cachelab.h"
+#include "typed-trans.h"
+
+/* Cache the registered int transposes tile for */
+static int int_line_bytes = TYPED_DEFAULT_LINE_BYTES;
+static int int_way_bytes = TYPED_DEFAULT_WAY_BYTES;
+
+/*
+ * typed_tile - Tile edge for elem_size-byte elements whose source and
+ *     destination rows are src_stride and dst_stride elements apart
+ */
+static int typed_tile(int elem_size, ptrdiff_t src_stride, ptrdiff_t dst_stride,
+                      int line_bytes, int way_bytes) {
+    ptrdiff_t strides[2] = { src_stride * elem_size, dst_stride * elem_size };
+    int tile = line_bytes / elem_size;
+    int k;
+
+    /* Rows a whole fraction of a way apart land in the same few sets */
+    for (k = 0; k < 2; k++)
+        if (strides[k] > 0 && way_bytes > 0 && way_bytes % strides[k] == 0
+            && tile > way_bytes / strides[k])
+            tile = way_bytes / strides[k];
+    return tile < 1 ? 1 : tile;
+}
+
+#define DEFINE_TYPED_TRANS(suffix, type)                                    \
+                                                                            \
+/* trans_view_<suffix> - View data as rows x cols with the given stride */ \
+trans_view_##suffix##_t trans_view_##suffix(type* data, int rows,           \
+                                            int cols, ptrdiff_t stride) {   \
+    trans_view_##suffix##_t v = { data, rows, cols, stride };               \
+    return v;                                                               \
+}                                                                           \
+                                                                            \
+/* trans_subview_<suffix> - The rows x cols block of v at (r0, c0) */       \
+trans_view_##suffix##_t trans_subview_##suffix(                             \
+    const trans_view_##suffix##_t* v, int r0, int c0, int rows, int cols) { \
+    trans_view_##suffix##_t sub = {                                         \
+        v->data + r0 * v->stride + c0, rows, cols, v->stride                \
+    };                                                                      \
+    return sub;                                                             \
+}                                                                           \
+                                                                            \
+/* transpose_<suffix> - Transpose one line-sized tile at a time */          \
+void transpose_##suffix(const trans_view_##suffix##_t* src,                 \
+                        const trans_view_##suffix##_t* dst,                 \
+                        int line_bytes, int way_bytes) {                    \
+    int tile = typed_tile(sizeof(type), src->stride, dst->stride,           \
+                          line_bytes, way_bytes);                           \
+    int ii, jj, i, j, i1, j1;                                               \
+                                                                            \
+    for (ii = 0; ii < src->rows; ii += tile) {                              \
+        i1 = ii + tile < src->rows ? ii + tile : src->rows;                 \
+        for (jj = 0; jj < src->cols; jj += tile) {                          \
+            j1 = jj + tile < src->cols ? jj + tile : src->cols;             \
+            for (i = ii; i < i1; i++) {                                     \
+                const type* row = src->data + i * src->stride;              \
+                for (j = jj; j < j1; j++)                                   \
+                    dst->data[j * dst->stride + i] = row[j];                \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+/* correct_trans_<suffix> - Reference transpose, one element at a time */   \
+void correct_trans_##suffix(const trans_view_##suffix##_t* src,             \
+                            const trans_view_##suffix##_t* dst) {           \
+    int i, j;                                                               \
+                                                                            \
+    for (i = 0; i < src->rows; i++)                                         \
+        for (j = 0; j < src->cols; j++)                                     \
+            dst->data[j * dst->stride + i] = src->data[i * src->stride + j]; \
+}
+
+DEFINE_TYPED_TRANS(u8, uint8_t)
+DEFINE_TYPED_TRANS(u16, uint16_t)
+DEFINE_TYPED_TRANS(u32, uint32_t)
+DEFINE_TYPED_TRANS(u64, uint64_t)
+
+/*
+ * transpose_typed - The 32-bit kernel on the whole of A and B
+ */
+char transpose_typed_desc[] = "Generic 32-bit blocked transpose";
+void transpose_typed(int M, int N, int A[M][N], int B[N][M]) {
+    trans_view_u32_t src = trans_view_u32((uint32_t*) &A[0][0], M, N, N);
+    trans_view_u32_t dst = trans_view_u32((uint32_t*) &B[0][0], N, M, M);
+
+    transpose_u32(&src, &dst, int_line_bytes, int_way_bytes);
+}
+
+/*
+ * transpose_typed_quadrants - The 32-bit kernel on each quadrant of A in
+ *     turn, written to the mirrored quadrant of B through sub-matrix views
+ */
+char transpose_typed_quadrants_desc[] = "Generic 32-bit transpose by quadrant views";
+void transpose_typed_quadrants(int M, int N, int A[M][N], int B[N][M]) {
+    trans_view_u32_t src = trans_view_u32((uint32_t*) &A[0][0], M, N, N);
+    trans_view_u32_t dst = trans_view_u32((uint32_t*) &B[0][0], N, M, M);
+    int rows[2] = { M / 2, M - M / 2 };
+    int cols[2] = { N / 2, N - N / 2 };
+    int qi, qj;
+
+    for (qi = 0; qi < 2; qi++)
+        for (qj = 0; qj < 2; qj++) {
+            trans_view_u32_t s = trans_subview_u32(&src, qi * rows[0], qj * cols[0],
+                                                   rows[qi], cols[qj]);
+            trans_view_u32_t d = trans_subview_u32(&dst, qj * cols[0], qi * rows[0],
+                                                   cols[qj], rows[qi]);
+            transpose_u32(&s, &d, int_line_bytes, int_way_bytes);
+        }
+}
+
+/*
+ * typed_trans_set_cache - Tile the int transposes for the given cache
+ */
+void typed_trans_set_cache(int line_bytes, int way_bytes) {
+    int_line_bytes = line_bytes;
+    int_way_bytes = way_bytes;
+}
+
+/*
+ * The check's parent matrices: odd strides, so that no two rows of a view
+ * are aligned alike, and big enough for every shape in check_shapes at
+ * CHECK_OFFSET from the corner
+ */
+#define CHECK_SRC_ROWS 70
+#define CHECK_SRC_STRIDE 71
+#define CHECK_DST_ROWS 72
+#define CHECK_DST_STRIDE 67
+#define CHECK_OFFSET 3
+
+/* Sub-view shapes, rows x cols of the source */
+static const int check_shapes[][2] = {
+    { 1, 1 }, { 1, 40 }, { 40, 1 }, { 13, 29 }, { 29, 13 },
+    { 33, 47 }, { 64, 5 }, { 17, 64 }, { 64, 60 },
+};
+
+/*
+ * DEFINE_TYPED_CHECK - check_<suffix>: transpose a sub-view of a filled
+ *     source into a sub-view of a destination, with the kernel and with
+ *     correct_trans_<suffix>, and compare the whole destinations, so stray
+ *     writes outside the view count too
+ */
+#define DEFINE_TYPED_CHECK(suffix, type)                                    \
+static int check_##suffix(int line_bytes, int way_bytes) {                                 \
+    static type src_data[CHECK_SRC_ROWS * CHECK_SRC_STRIDE];                \
+    static type got[CHECK_DST_ROWS * CHECK_DST_STRIDE];                     \
+    static type expected[CHECK_DST_ROWS * CHECK_DST_STRIDE];                \
+    trans_view_##suffix##_t src_parent = trans_view_##suffix(               \
+        src_data, CHECK_SRC_ROWS, CHECK_SRC_STRIDE, CHECK_SRC_STRIDE);      \
+    trans_view_##suffix##_t got_parent = trans_view_##suffix(               \
+        got, CHECK_DST_ROWS, CHECK_DST_STRIDE, CHECK_DST_STRIDE);           \
+    trans_view_##suffix##_t expected_parent = trans_view_##suffix(          \
+        expected, CHECK_DST_ROWS, CHECK_DST_STRIDE, CHECK_DST_STRIDE);      \
+    size_t i, n = sizeof(check_shapes) / sizeof(check_shapes[0]);          \
+    int failures = 0;                                                       \
+                                                                            \
+    for (i = 0; i < sizeof(src_data) / sizeof(type); i++)                   \
+        src_data[i] = (type) (i * 2654435761u + 1);                         \
+    for (i = 0; i < n; i++) {                                               \
+        int rows = check_shapes[i][0], cols = check_shapes[i][1];           \
+        trans_view_##suffix##_t src = trans_subview_##suffix(               \
+            &src_parent, CHECK_OFFSET, CHECK_OFFSET + 1, rows, cols);       \
+        trans_view_##suffix##_t dst = trans_subview_##suffix(               \
+            &got_parent, CHECK_OFFSET + 1, CHECK_OFFSET, cols, rows);       \
+        trans_view_##suffix##_t ref = trans_subview_##suffix(               \
+            &expected_parent, CHECK_OFFSET + 1, CHECK_OFFSET, cols, rows);  \
+                                                                            \
+        memset(got, 0xa5, sizeof(got));                                     \
+        memset(expected, 0xa5, sizeof(expected));                           \
+        transpose_##suffix(&src, &dst, line_bytes, way_bytes);              \
+        correct_trans_##suffix(&src, &ref);                                 \
+        if (memcmp(got, expected, sizeof(got)) != 0) {                      \
+            printf("Error: transpose_" #suffix " is wrong on a %dx%d view " \
+                   "with %d-byte lines\n", rows, cols, line_bytes);         \
+            failures++;                                                     \
+        }                                                                   \
+    }                                                                       \
+    return failures;                                                        \
+}
+
+DEFINE_TYPED_CHECK(u8, uint8_t)
+DEFINE_TYPED_CHECK(u16, uint16_t)
+DEFINE_TYPED_CHECK(u32, uint32_t)
+DEFINE_TYPED_CHECK(u64, uint64_t)
+
+/*
+ * typed_trans_check - Check the kernel of every element type
+ */
+int typed_trans_check(int line_bytes, int way_bytes) {
+    return check_u8(line_bytes, way_bytes) + check_u16(line_bytes, way_bytes)
+           + check_u32(line_bytes, way_bytes) + check_u64(line_bytes, way_bytes);
+}
+
+/*
+ * registerTypedFunctions - Register the int transposes above
+ */
+void registerTypedFunctions() {
+    registerTransFunction(transpose_typed, transpose_typed_desc);
+    registerTransFunction(transpose_typed_quadrants, transpose_typed_quadrants_desc);
+}
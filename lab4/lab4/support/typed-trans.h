@@ -0,0 +1,73 @@
+/*
+ * typed-trans.h - Blocked transposes for 8-, 16-, 32- and 64-bit elements
+ *     (uint8 images, fp16 tensors, floats and doubles), generated from one
+ *     macro. Each works on a strided view: a matrix whose rows start
+ *     `stride` elements apart, so a sub-matrix of a larger one is just a
+ *     pointer to its first element plus the parent's stride.
+ *
+ * Each kernel is given the geometry of the cache it is tiling for: its
+ * line size and the bytes one way spans (sets x line size). The tile edge
+ * is line_bytes / sizeof(element), so a tile row of the source and a tile
+ * column of the destination each fill a cache line, unless the rows of
+ * either view are a whole fraction of a way apart. Then only that many
+ * rows fit before they evict each other, and the tile shrinks to them.
+ */
+
+#ifndef TYPED_TRANS_H
+#define TYPED_TRANS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Cache the registered int transposes tile for until told otherwise: an
+   x86 L1 with 64 sets of 64-byte lines */
+#define TYPED_DEFAULT_LINE_BYTES 64
+#define TYPED_DEFAULT_WAY_BYTES 4096
+
+/*
+ * Declares, for element type `type`:
+ *   trans_view_<suffix>_t                      its strided view
+ *   trans_view_<suffix>(data, rows, cols, stride)  make a view
+ *   trans_subview_<suffix>(v, r0, c0, rows, cols)  a block of a view
+ *   transpose_<suffix>(src, dst, line_bytes, way_bytes)  dst = src^T, blocked
+ *   correct_trans_<suffix>(src, dst)           dst = src^T, naively
+ * dst must be src->cols x src->rows and must not overlap src.
+ */
+#define DECLARE_TYPED_TRANS(suffix, type)                                   \
+    typedef struct trans_view_##suffix {                                    \
+        type* data;                                                         \
+        int rows, cols;                                                     \
+        ptrdiff_t stride;           /* elements between row starts */       \
+    } trans_view_##suffix##_t;                                              \
+    trans_view_##suffix##_t trans_view_##suffix(type* data, int rows,       \
+                                                int cols, ptrdiff_t stride); \
+    trans_view_##suffix##_t trans_subview_##suffix(                         \
+        const trans_view_##suffix##_t* v, int r0, int c0, int rows, int cols); \
+    void transpose_##suffix(const trans_view_##suffix##_t* src,             \
+                            const trans_view_##suffix##_t* dst,             \
+                            int line_bytes, int way_bytes);                 \
+    void correct_trans_##suffix(const trans_view_##suffix##_t* src,         \
+                                const trans_view_##suffix##_t* dst);
+
+DECLARE_TYPED_TRANS(u8, uint8_t)
+DECLARE_TYPED_TRANS(u16, uint16_t)
+DECLARE_TYPED_TRANS(u32, uint32_t)
+DECLARE_TYPED_TRANS(u64, uint64_t)
+
+/*
+ * Register int transposes built on the 32-bit kernel: one on the whole
+ * matrices and one that transposes them as four sub-matrix views
+ */
+void registerTypedFunctions();
+
+/* Tile the registered int transposes for the given cache geometry */
+void typed_trans_set_cache(int line_bytes, int way_bytes);
+
+/*
+ * Check every element type's kernel against correct_trans_<suffix> on
+ * non-square sub-views of matrices with odd row strides, tiled for the
+ * given cache geometry. Prints each failure and returns the number of them.
+ */
+int typed_trans_check(int line_bytes, int way_bytes);
+
+#endif /* TYPED_TRANS_H */
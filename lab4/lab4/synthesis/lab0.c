@@ -19,7 +19,10 @@
 //   assert.h - contains declaration of assert()
 //   stdio.h  - contains declaration of printf()
 //   stdlib.h - contains declaration of malloc() and free()
-//   time.h   - contains declaration of clock()
+//   time.h   - contains declaration of clock_gettime()
+// The #define before them asks the headers to also declare
+// functions from the POSIX standard, like clock_gettime().
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -27,11 +30,12 @@
 
 
 // This #define tells the C preprocessor to do a straight
-// substitution of instances of the text "SIZE" in the code
-// below with the text "500". This example acts like a
-// global variable without actually allocating memory for
-// a variable.
-#define SIZE 500
+// substitution of instances of the text "DEFAULT_MAX_MB" in
+// the code below with the text "1024". This example acts
+// like a global variable without actually allocating memory
+// for a variable. It is the largest working set, in MiB,
+// that part 4 measures unless told otherwise.
+#define DEFAULT_MAX_MB 1024
 
 
 /**** LOOK AT MAIN() AT THE BOTTOM OF THIS FILE FIRST ****/
@@ -203,47 +207,442 @@ void part3() {
 //
 // To create a sufficiently large array, it must be created
 // in the Heap using malloc(). We will use this array like
-// a 3D array, so this function mimics multi-level array
-// syntax: bigArray[bigArrayIndex(i,j,k)] is equivalent to
-// bigArray[i][j][k] if bigArray[] were a 3D array.
-int bigArrayIndex(int i, int j, int k) {
-    return SIZE * SIZE * i + SIZE * j + k;
+// a 3D array of n x n x n ints, so this function mimics
+// multi-level array syntax: bigArray[bigArrayIndex(n,i,j,k)]
+// is equivalent to bigArray[i][j][k] if bigArray[] were a 3D
+// array.
+long bigArrayIndex(long n, long i, long j, long k) {
+    return n * n * i + n * j + k;
 }
 
 
+
 // PART 4 - Performance
 //
 // It turns out that "Big O" is not the only important thing
 // in determining how quickly a program executes.
 // Here we will see that even without altering results,
 // changing the order of memory accesses can alter execution
-// speed.
-void part4() {
+// speed. Part 4 is a suite of small benchmarks that each
+// touch memory in one pattern, on working sets from 4 KiB
+// up to 1 GiB (or the size given on the command line).
+// Where a working set stops fitting in a level of the cache
+// the results jump: those "cliffs" give away the sizes of
+// the caches (and TLBs) of the machine it runs on.
+//
+// Compile it with optimization (gcc -O2) to measure memory
+// rather than loop overhead. The largest working sets take
+// a minute or more; "./lab0 4 64" stops at 64 MiB.
+
+// Smallest working set, in bytes
+#define MIN_WORKING_SET (4L << 10)
+
+// Each measurement is repeated up to this many times, after
+// an untimed warm-up run, and the fastest run is reported:
+// the others were slowed down by something else.
+#define REPEATS 5
+
+// ...but a measurement stops repeating after this long, so
+// the largest working sets are only run once or twice.
+#define TIME_LIMIT_NS 1e9
+
+// Every run makes at least this many accesses, so that it
+// takes long enough for the clock to time accurately.
+#define MIN_ACCESSES (1L << 22)
+
+// Bytes per cache line, for the pointer chase
+#define LINE_SIZE 64
+
+// Edge of the tiles in the blocked traversal: 16 ints fill
+// one 64-byte cache line
+#define BLOCK 16
+
+// Strides in the stride sweep, in ints: 1, 2, 4, ... 1024
+#define NUM_STRIDES 11
+
+
+// What a benchmark needs to know to do one timed run.
+typedef struct {
+    int* array;         // the working set...
+    long len;           // ...and how many ints it holds
+    long n;             // edge of the 2D or 3D array in it
+    long stride[3];     // loop strides for the loop orders
+    long passes;        // how many times to go over it
+    long steps;         // accesses, for random and chasing
+} Workload;
+
+// Benchmarks add up what they read into sink, which is
+// printed at the end, so that the compiler cannot decide
+// the reads are useless and remove them.
+long sink = 0;
+
+
+// HELPER FUNCTION - nowNs()
+//
+// clock() counts CPU time in coarse ticks. clock_gettime()
+// reads a clock with nanosecond resolution instead, and
+// CLOCK_MONOTONIC never jumps when the system time is set.
+double nowNs() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+// HELPER FUNCTION - bestTime()
+//
+// Time run(w) as described above REPEATS, and return the
+// fastest run in nanoseconds. The warm-up run fills the
+// caches and TLB the way the timed runs will find them; it
+// is timed after all if it alone takes TIME_LIMIT_NS.
+double bestTime(long (*run)(Workload*), Workload* w) {
+    double best = 0, total = 0;
+    for (int rep = 0; rep <= REPEATS; rep++) {
+        double start = nowNs();
+        sink += run(w);
+        double elapsed = nowNs() - start;
+        total += elapsed;
+        if (rep == 0 && elapsed < TIME_LIMIT_NS) {
+            continue;
+        }
+        if (best == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        if (total >= TIME_LIMIT_NS) {
+            break;
+        }
+    }
+    return best;
+}
+
+
+// HELPER FUNCTION - passesFor()
+//
+// How many times to go over accesses elements so that a run
+// makes at least MIN_ACCESSES accesses.
+long passesFor(long accesses) {
+    return accesses >= MIN_ACCESSES ? 1 : MIN_ACCESSES / accesses;
+}
+
+
+// HELPER FUNCTION - printSize()
+//
+// Print a working set size in KiB or MiB, right-aligned.
+void printSize(long bytes) {
+    if (bytes >= (1L << 20)) {
+        printf("%8ld MiB", bytes >> 20);
+    } else {
+        printf("%8ld KiB", bytes >> 10);
+    }
+}
+
+
+// BENCHMARK - loopOrder()
+//
+// Write array[i][j][k] = i + j + k over an n x n x n array,
+// with the loops nested in any order. stride[0] is how far
+// apart in memory consecutive values of the outer loop's
+// variable are, stride[2] the inner loop's; since i + j + k
+// does not care which variable is which, neither does the
+// loop body.
+long loopOrder(Workload* w) {
+    long n = w->n;
+    long s0 = w->stride[0], s1 = w->stride[1], s2 = w->stride[2];
+    for (long pass = 0; pass < w->passes; pass++) {
+        for (long x = 0; x < n; x++) {
+            for (long y = 0; y < n; y++) {
+                int* line = w->array + x * s0 + y * s1;
+                for (long z = 0; z < n; z++) {
+                    line[z * s2] = x + y + z;
+                }
+            }
+        }
+    }
+    return w->array[w->len - 1];
+}
+
+
+// BENCHMARK - rowOrder()
+//
+// Write every element of an n x n array, row by row.
+long rowOrder(Workload* w) {
+    long n = w->n;
+    for (long pass = 0; pass < w->passes; pass++) {
+        for (long i = 0; i < n; i++) {
+            for (long j = 0; j < n; j++) {
+                w->array[i * n + j] = i + j;
+            }
+        }
+    }
+    return w->array[w->len - 1];
+}
+
+
+// BENCHMARK - columnOrder()
+//
+// Write every element of an n x n array, column by column:
+// consecutive writes are a whole row apart.
+long columnOrder(Workload* w) {
+    long n = w->n;
+    for (long pass = 0; pass < w->passes; pass++) {
+        for (long j = 0; j < n; j++) {
+            for (long i = 0; i < n; i++) {
+                w->array[i * n + j] = i + j;
+            }
+        }
+    }
+    return w->array[w->len - 1];
+}
+
+
+// BENCHMARK - blockedColumnOrder()
+//
+// Column by column again, but within BLOCK x BLOCK tiles:
+// each tile's BLOCK rows stay cached while its columns are
+// written, so every cache line is brought in once.
+long blockedColumnOrder(Workload* w) {
+    long n = w->n;
+    for (long pass = 0; pass < w->passes; pass++) {
+        for (long ii = 0; ii < n; ii += BLOCK) {
+            for (long jj = 0; jj < n; jj += BLOCK) {
+                for (long j = jj; j < jj + BLOCK && j < n; j++) {
+                    for (long i = ii; i < ii + BLOCK && i < n; i++) {
+                        w->array[i * n + j] = i + j;
+                    }
+                }
+            }
+        }
+    }
+    return w->array[w->len - 1];
+}
+
+
+// BENCHMARK - stridedRead()
+//
+// Read every stride[0]-th int, like the "memory mountain"
+// in the textbook: the larger the stride, the fewer ints
+// are used from each cache line brought in.
+long stridedRead(Workload* w) {
+    long sum = 0;
+    for (long pass = 0; pass < w->passes; pass++) {
+        for (long i = 0; i < w->len; i += w->stride[0]) {
+            sum += w->array[i];
+        }
+    }
+    return sum;
+}
+
+
+// BENCHMARK - sequentialRead()
+//
+// Read every int in order, with four running sums so that
+// the additions do not limit how fast the loads can go.
+long sequentialRead(Workload* w) {
+    long sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    for (long pass = 0; pass < w->passes; pass++) {
+        for (long i = 0; i < w->len; i += 4) {
+            sum0 += w->array[i];
+            sum1 += w->array[i + 1];
+            sum2 += w->array[i + 2];
+            sum3 += w->array[i + 3];
+        }
+    }
+    return sum0 + sum1 + sum2 + sum3;
+}
+
+
+// BENCHMARK - randomRead()
+//
+// Read ints at random places. Each index comes from a
+// xorshift random number generator rather than from memory,
+// so the loads do not depend on each other and the CPU can
+// have several of them waiting on the cache at once.
+long randomRead(Workload* w) {
+    unsigned long x = 88172645463325252UL;
+    long sum = 0;
+    for (long step = 0; step < w->steps; step++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sum += w->array[x & (w->len - 1)];  // len is a power of two
+    }
+    return sum;
+}
+
+
+// BENCHMARK - pointerChase()
+//
+// Follow a chain of pointers (set up by makeChain() below)
+// around the working set. Each load needs the address the
+// one before it returned, so they happen one at a time: the
+// time per step is the latency of wherever the chain lives.
+long pointerChase(Workload* w) {
+    void** p = (void**) w->array;
+    for (long step = 0; step < w->steps; step++) {
+        p = (void**) *p;
+    }
+    return (long) p;
+}
+
+
+// HELPER FUNCTION - makeChain()
+//
+// Link the first int of every cache line in the working set
+// into one cycle in random order, so that no prefetcher can
+// guess the next line. Sattolo's algorithm shuffles the
+// lines into a random permutation with a single cycle.
+void makeChain(Workload* w, long* next) {
+    long lines = w->len * sizeof(int) / LINE_SIZE;
+    long ints = LINE_SIZE / sizeof(int);
+    unsigned long x = 2463534242UL;
+    for (long i = 0; i < lines; i++) {
+        next[i] = i;
+    }
+    for (long i = lines - 1; i > 0; i--) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        long j = x % i;         // j < i, which makes it one cycle
+        long tmp = next[i];
+        next[i] = next[j];
+        next[j] = tmp;
+    }
+    for (long i = 0; i < lines; i++) {
+        *(void**) &w->array[i * ints] = &w->array[next[i] * ints];
+    }
+}
+
+
+// The six ways to nest the i, j and k loops.
+const char* loopOrders[6] = { "ijk", "ikj", "jik", "jki", "kij", "kji" };
+
+
+// PART 4 - Benchmark suite
+//
+// Runs every benchmark above on each working set and prints
+// a table of results per benchmark. Times are per element
+// (or access) in nanoseconds; bandwidths are in GB/s.
+void part4(long maxBytes) {
     printf("*** LAB 0 PART 4 ***\n");
 
-    // Raw execution times are often poor metrics due to
-    // inconsistencies and dependence on system, but they
-    // can still be used to show general trends.
-    clock_t timer;
-    // allocate space in the Heap for a "3D array"
-    int* bigArray = (int*) malloc(SIZE * SIZE * SIZE * sizeof(int));
-    // start timer
-    timer = clock();
-
-
-    // Q4: Try changing the order of the loops (switch the
-    // "for" lines). The original ordering below is
-    // considered "ijk".  Which loop orderings are fastest?
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            for (int k = 0; k < SIZE; k++) {
-                bigArray[bigArrayIndex(i, j, k)] = i + j + k;
+    // allocate space in the Heap for the largest working set,
+    // and a helper array for building pointer chains
+    int* bigArray = (int*) malloc(maxBytes);
+    long* next = (long*) malloc(maxBytes / LINE_SIZE * sizeof(long));
+    if (bigArray == NULL || next == NULL) {
+        printf("Unable to allocate %ld bytes\n", maxBytes);
+        exit(1);
+    }
+    // Touch every page now, so the first benchmark does not
+    // pay for the operating system handing them out.
+    for (long i = 0; i < maxBytes / (long) sizeof(int); i++) {
+        bigArray[i] = 1;
+    }
+    Workload w;
+    w.array = bigArray;
+    printf("Best of %d runs per measurement, working sets of ", REPEATS);
+    printSize(MIN_WORKING_SET);
+    printf(" to");
+    printSize(maxBytes);
+    printf("\n");
+
+
+    // Q4: The original ordering of the loops (i outside,
+    // then j, then k inside) is considered "ijk". Which loop
+    // orderings are fastest? Where do the slow ones fall off
+    // a cliff, and why there?
+    printf("\nLoop orders, ns per element written to an n x n x n array\n");
+    printf("%12s %6s", "Working set", "n");
+    for (int order = 0; order < 6; order++) {
+        printf(" %8s", loopOrders[order]);
+    }
+    printf("\n");
+    for (long bytes = MIN_WORKING_SET; bytes <= maxBytes; bytes *= 8) {
+        long n = 1;
+        while ((n + 1) * (n + 1) * (n + 1) * (long) sizeof(int) <= bytes) {
+            n++;
+        }
+        w.n = n;
+        w.len = n * n * n;
+        w.passes = passesFor(w.len);
+        printSize(bytes);
+        printf(" %6ld", n);
+        for (int order = 0; order < 6; order++) {
+            // Look up how far apart consecutive values of the
+            // outer, middle and inner loop variables are
+            for (int level = 0; level < 3; level++) {
+                char var = loopOrders[order][level];
+                w.stride[level] = bigArrayIndex(n, var == 'i', var == 'j', var == 'k');
             }
+            printf(" %8.2f", bestTime(loopOrder, &w) / (w.len * w.passes));
+            fflush(stdout);
         }
+        printf("\n");
     }
 
-    // stop timer and print result
-    printf("Approximate runtime = %d\n", (int)(clock() - timer));
+
+    printf("\nBlocked traversal, ns per element written to an n x n array\n");
+    printf("%12s %6s %8s %8s %8s\n", "Working set", "n", "rows", "columns", "blocked");
+    for (long bytes = MIN_WORKING_SET; bytes <= maxBytes; bytes *= 4) {
+        long n = 1;
+        while ((n + 1) * (n + 1) * (long) sizeof(int) <= bytes) {
+            n++;
+        }
+        w.n = n;
+        w.len = n * n;
+        w.passes = passesFor(w.len);
+        printSize(bytes);
+        printf(" %6ld", n);
+        printf(" %8.2f", bestTime(rowOrder, &w) / (w.len * w.passes));
+        printf(" %8.2f", bestTime(columnOrder, &w) / (w.len * w.passes));
+        printf(" %8.2f\n", bestTime(blockedColumnOrder, &w) / (w.len * w.passes));
+        fflush(stdout);
+    }
+
+
+    printf("\nStride sweep, GB/s of ints read\n");
+    printf("%12s", "Working set");
+    for (int s = 0; s < NUM_STRIDES; s++) {
+        printf(" %6ldB", (1L << s) * (long) sizeof(int));
+    }
+    printf("\n");
+    for (long bytes = MIN_WORKING_SET; bytes <= maxBytes; bytes *= 4) {
+        w.len = bytes / sizeof(int);
+        printSize(bytes);
+        for (int s = 0; s < NUM_STRIDES; s++) {
+            long reads = w.len >> s;
+            w.stride[0] = 1L << s;
+            w.passes = passesFor(reads);
+            double ns = bestTime(stridedRead, &w);
+            printf(" %7.2f", reads * w.passes * sizeof(int) / ns);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+
+    // The latency and bandwidth curves: one row per power of
+    // two working set, so the cliffs show up clearly.
+    printf("\nSequential vs. random access\n");
+    printf("%12s %10s %10s %10s %10s\n", "Working set", "seq GB/s",
+           "seq ns", "random ns", "chase ns");
+    for (long bytes = MIN_WORKING_SET; bytes <= maxBytes; bytes *= 2) {
+        w.len = bytes / sizeof(int);
+        w.passes = passesFor(w.len);
+        w.steps = MIN_ACCESSES;
+        printSize(bytes);
+        double ns = bestTime(sequentialRead, &w);
+        printf(" %10.2f", w.len * w.passes * sizeof(int) / ns);
+        printf(" %10.3f", ns / (w.len * w.passes));
+        printf(" %10.2f", bestTime(randomRead, &w) / w.steps);
+        makeChain(&w, next);
+        printf(" %10.2f\n", bestTime(pointerChase, &w) / w.steps);
+        fflush(stdout);
+    }
+
+    printf("\n(checksum %ld)\n", sink);
+    free(next);
+    free(bigArray);
 }
 
 
@@ -289,18 +688,28 @@ void part5() {
 int main(int argc, char* argv[]) {
     // input checking - note that the executable name is
     // included in the argument count
-    if ( argc != 2 || !atoi(argv[1]) ) {
-        printf("Usage: %s <num>\n", argv[0]);
+    if ( argc < 2 || argc > 3 || !atoi(argv[1]) ) {
+        printf("Usage: %s <num> [MiB]\n", argv[0]);
+        printf("  MiB: part 4's largest working set (default %d)\n",
+               DEFAULT_MAX_MB);
         exit(0);
     }
 
+    // Part 4 measures working sets up to this many bytes.
+    // Working sets are powers of two, so round down to one.
+    long maxBytes = (long) (argc == 3 ? atol(argv[2]) : DEFAULT_MAX_MB) << 20;
+    long powerOfTwo = MIN_WORKING_SET;
+    while (powerOfTwo * 2 <= maxBytes) {
+        powerOfTwo *= 2;
+    }
+
     // atoi() is a library function that converts a String
     // to an integer
     switch ( atoi(argv[1]) ) {
         case 1:   part1();  break;
         case 2:   part2();  break;
         case 3:   part3();  break;
-        case 4:   part4();  break;
+        case 4:   part4(powerOfTwo);  break;
         case 5:   part5();  break;
         default:  printf("No part %s in this lab!\n", argv[1]);
                   exit(0);
@@ -1,6 +1,7 @@
 #include "mm.h"
 #include "memlib.h"
 
+#include <stddef.h>
 #include <stdio.h>
 
 int verbose = 0;        /* global flag for verbose output */
@@ -9,6 +10,22 @@ int verbose = 0;        /* global flag for verbose output */
 
 #define NUM_ROOTS 3
 
+// Number of unreachable blocks left behind by the lazy sweeping scenario.
+#define NUM_GARBAGE 512
+
+// Number of list nodes kept alive by the compaction scenario.
+#define NUM_NODES 256
+
+// Length of the linked list, and number of blocks pointed to by one wide
+// block, in the deep marking scenario. Both are far beyond what recursive
+// marking or a bounded mark stack could handle directly.
+#define CHAIN_LENGTH 400000
+#define FAN_OUT 100000
+
+// Leaves the mutator frees between the steps of the incremental deep marking
+// scenario.
+#define FREES_PER_STEP 192
+
 typedef struct obj_1 {
     void* ptr1;
     void* ptr2;
@@ -27,8 +44,21 @@ typedef struct obj_3 {
     void* ptr1;
 } obj_3;
 
+typedef struct node {
+    long value;
+    struct node* next;
+    struct node* prev;
+} node;
+
 static void initialize_blocks(void);
 static void validate_garbage_collect(void);
+static void validate_lazy_sweep(void);
+static void validate_incremental_marking(void);
+static void validate_minor_collect(void);
+static void validate_compaction(void);
+static void validate_deep_marking(void);
+static int in_heap(void* ptr);
+static size_t block_size(void* payloadPtr);
 static int is_free(void* payloadPtr);
 
 static obj_1* block1;
@@ -58,8 +88,15 @@ int main() {
 
   initialize_blocks();
   mm_garbage_collect(roots, NUM_ROOTS);
+  mm_finish_sweep();
   validate_garbage_collect();
 
+  validate_lazy_sweep();
+  validate_incremental_marking();
+  validate_minor_collect();
+  validate_compaction();
+  validate_deep_marking();
+
   /*Free the remaining memory*/
   mem_deinit();
   return 0;
@@ -146,6 +183,421 @@ static void validate_garbage_collect(void) {
   }
 }
 
+static void validate_lazy_sweep(void) {
+  // Garbage left behind by mm_garbage_collect should be reclaimed by later
+  // mm_malloc calls, without sweeping it all up front or growing the heap.
+  obj_1* garbage[NUM_GARBAGE];
+  obj_1* live;
+  size_t heap_size;
+  int wasError = 0;
+  int i;
+
+  mem_reset_brk();
+  mm_init();
+
+  live = mm_malloc(sizeof(obj_1));
+  live->ptr1 = NULL;
+  live->ptr2 = (void*) 351;
+  live->ptr3 = NULL;
+  for (i = 0; i < NUM_GARBAGE; i++) {
+    garbage[i] = mm_malloc(sizeof(obj_1));
+  }
+  roots[0] = (void*) live;
+  heap_size = mem_heapsize();
+
+  mm_garbage_collect(roots, 1);
+
+  if (is_free(garbage[NUM_GARBAGE - 1])) {
+    printf("ERROR: The whole heap was swept during mm_garbage_collect\n");
+    wasError = 1;
+  }
+
+  for (i = 0; i < NUM_GARBAGE; i++) {
+    garbage[i] = mm_malloc(sizeof(obj_1));
+  }
+  mm_finish_sweep();
+
+  if (mem_heapsize() != heap_size) {
+    printf("ERROR: The heap grew instead of reusing unreachable blocks\n");
+    wasError = 1;
+  }
+
+  if (is_free(live) || live->ptr2 != (void*) 351) {
+    printf("ERROR: A block that was reachable was freed!\n");
+    wasError = 1;
+  }
+
+  for (i = 0; i < NUM_GARBAGE; i++) {
+    if (is_free(garbage[i])) {
+      printf("ERROR: A block allocated during the sweep was freed!\n");
+      wasError = 1;
+      break;
+    }
+  }
+
+  if (!wasError) {
+    printf("Success! Lazy sweeping passed all of the tests\n");
+  }
+}
+
+static void validate_incremental_marking(void) {
+  // The mutator runs between marking steps and rearranges the graph behind
+  // the collector's back; the write barrier has to keep everything it can
+  // still reach alive.
+  obj_1* a;
+  obj_1* b;
+  obj_3* c;
+  obj_3* d;
+  obj_3* e;
+  obj_3* n;
+  int wasError = 0;
+
+  mem_reset_brk();
+  mm_init();
+
+  // a -> b -> c, and two unreachable blocks d and e
+  a = mm_malloc(sizeof(obj_1));
+  b = mm_malloc(sizeof(obj_1));
+  c = mm_malloc(sizeof(obj_3));
+  d = mm_malloc(sizeof(obj_3));
+  e = mm_malloc(sizeof(obj_3));
+
+  a->ptr1 = b;
+  a->ptr2 = NULL;
+  a->ptr3 = NULL;
+  b->ptr1 = c;
+  b->ptr2 = NULL;
+  b->ptr3 = NULL;
+  c->ptr1 = NULL;
+  d->ptr1 = NULL;
+  e->ptr1 = NULL;
+
+  roots[0] = (void*) a;
+  roots[1] = NULL;
+
+  mm_gc_start(roots, 2);
+
+  // One small step scans a (black) and leaves b gray and c white.
+  if (mm_gc_step(1)) {
+    printf("ERROR: Marking finished in a single small step\n");
+    wasError = 1;
+  }
+
+  // Move the only reference to c into black a, allocate a new block during
+  // marking, and make the unreachable e a root.
+  mm_write_barrier(&a->ptr2, c);
+  mm_write_barrier(&b->ptr1, NULL);
+  n = mm_malloc(sizeof(obj_3));
+  n->ptr1 = NULL;
+  mm_write_barrier(&a->ptr3, n);
+  roots[1] = (void*) e;
+
+  while (!mm_gc_step(1)) {
+  }
+  mm_finish_sweep();
+
+  if (is_free(a) || is_free(b) || is_free(c) || is_free(e) || is_free(n)) {
+    printf("ERROR: A block that was reachable was freed!\n");
+    wasError = 1;
+  }
+
+  if (!is_free(d)) {
+    printf("ERROR: A block that was not reachable was not freed\n");
+    wasError = 1;
+  }
+
+  if (!wasError) {
+    printf("Success! Incremental marking passed all of the tests\n");
+  }
+}
+
+static void validate_minor_collect(void) {
+  // Young blocks reachable from the roots or from an old block (through the
+  // write barrier's card marks) should be promoted into the heap with their
+  // contents and the pointers to them updated; the rest should be dropped.
+  obj_1* old;
+  obj_1* y1;
+  obj_2* y2;
+  obj_3* y3;
+  obj_3* y4;
+  obj_1* promoted1;
+  obj_2* promoted2;
+  obj_3* promoted4;
+  int num_promoted;
+  int wasError = 0;
+
+  mem_reset_brk();
+  mm_init();
+
+  old = mm_malloc(sizeof(obj_1));
+  old->ptr1 = NULL;
+  old->ptr2 = NULL;
+  old->ptr3 = NULL;
+
+  // y1 -> y2 -> old, y3 is garbage and y4 is only reachable from old
+  y1 = mm_malloc_young(sizeof(obj_1));
+  y2 = mm_malloc_young(sizeof(obj_2));
+  y3 = mm_malloc_young(sizeof(obj_3));
+  y4 = mm_malloc_young(sizeof(obj_3));
+
+  y1->ptr1 = y2;
+  y1->ptr2 = NULL;
+  y1->ptr3 = (void*) 1;
+  y2->a = 351;
+  y2->ptr1 = NULL;
+  y2->b = 410;
+  y2->d = 1.1;
+  y2->ptr2 = old;
+  y3->ptr1 = y1;
+  y4->ptr1 = NULL;
+  mm_write_barrier(&old->ptr2, y4);
+
+  roots[0] = (void*) y1;
+  roots[1] = (void*) old;
+
+  if (in_heap(y1) || in_heap(y4)) {
+    printf("ERROR: Young blocks were allocated in the heap\n");
+    wasError = 1;
+  }
+
+  num_promoted = mm_minor_collect(roots, 2);
+
+  promoted1 = roots[0];
+  promoted2 = promoted1->ptr1;
+  promoted4 = old->ptr2;
+
+  if (num_promoted != 3) {
+    printf("ERROR: Expected 3 promoted blocks but got %d\n", num_promoted);
+    wasError = 1;
+  }
+
+  if (!in_heap(promoted1) || !in_heap(promoted2) || !in_heap(promoted4)
+      || is_free(promoted1) || is_free(promoted2) || is_free(promoted4)
+      || roots[1] != (void*) old || is_free(old)) {
+    printf("ERROR: A reachable young block was not promoted into the heap\n");
+    wasError = 1;
+  } else if (promoted1->ptr3 != (void*) 1 || promoted2->a != 351 || promoted2->b != 410
+             || promoted2->d != 1.1 || promoted2->ptr2 != old || promoted4->ptr1 != NULL) {
+    printf("ERROR: A promoted block lost its contents\n");
+    wasError = 1;
+  }
+
+  // The nursery is empty again, and a full collection keeps the promoted
+  // blocks alive.
+  mm_garbage_collect(roots, 2);
+  mm_finish_sweep();
+  if (is_free(promoted1) || is_free(promoted2) || is_free(promoted4) || is_free(old)) {
+    printf("ERROR: A block that was reachable was freed!\n");
+    wasError = 1;
+  }
+
+  if (!wasError) {
+    printf("Success! Minor collection passed all of the tests\n");
+  }
+}
+
+static void validate_compaction(void) {
+  // A list whose nodes are interleaved with garbage should be slid down to
+  // the bottom of the heap, in order and with its pointers updated, and the
+  // space freed above it trimmed off.
+  size_t ptr_offsets[] = {offsetof(node, next), offsetof(node, prev)};
+  void** root_slots[2];
+  node* head = NULL;
+  node* tail = NULL;
+  node* n;
+  node* expected;
+  size_t heap_size;
+  int layout;
+  int trimmed;
+  int wasError = 0;
+  int i;
+
+  mem_reset_brk();
+  mm_init();
+  layout = mm_register_layout(sizeof(node), ptr_offsets, 2);
+
+  for (i = 0; i < NUM_NODES; i++) {
+    node* garbage = mm_malloc_layout(layout);
+    n = mm_malloc_layout(layout);
+    n->value = i;
+    n->next = NULL;
+    n->prev = tail;
+    if (tail == NULL) {
+      head = n;
+    } else {
+      tail->next = n;
+    }
+    tail = n;
+
+    // Garbage may point to live blocks, but nothing live points to it.
+    garbage->value = -1;
+    garbage->next = n;
+    garbage->prev = NULL;
+  }
+  heap_size = mem_heapsize();
+
+  root_slots[0] = (void**) &head;
+  root_slots[1] = (void**) &tail;
+  trimmed = mm_compact_collect(root_slots, 2);
+
+  if (trimmed <= 0 || mem_heapsize() != heap_size - trimmed) {
+    printf("ERROR: The heap was not trimmed after compaction\n");
+    wasError = 1;
+  }
+
+  // The list should start at the first block and be laid out contiguously.
+  expected = (node*) ((char*) mem_heap_lo() + 2 * WORD_SIZE);
+  n = head;
+  for (i = 0; i < NUM_NODES && !wasError; i++) {
+    if (n != expected || is_free(n) || n->value != i
+        || n->prev != (i == 0 ? NULL : (node*) ((char*) n - block_size(n)))) {
+      printf("ERROR: The list was not compacted correctly at node %d\n", i);
+      wasError = 1;
+    }
+    expected = (node*) ((char*) n + block_size(n));
+    if (n->next == NULL && i != NUM_NODES - 1) {
+      printf("ERROR: The list was cut short after compaction\n");
+      wasError = 1;
+    }
+    n = n->next;
+  }
+  if (!wasError && (tail != (node*) ((char*) expected - block_size(tail)) || tail->next != NULL)) {
+    printf("ERROR: A root was not updated by compaction\n");
+    wasError = 1;
+  }
+
+  // Allocation carries on right after the last live block.
+  if (!wasError && mm_malloc_layout(layout) != (void*) expected) {
+    printf("ERROR: Allocation after compaction did not bump from the top\n");
+    wasError = 1;
+  }
+
+  if (!wasError) {
+    printf("Success! Mark-compact passed all of the tests\n");
+  }
+}
+
+static void validate_deep_marking(void) {
+  // A very long chain (like block7 -> block8 -> block9, but without the
+  // cycle) and a block pointing to more blocks than the mark stack holds.
+  obj_3* chain_head = NULL;
+  obj_3* chain_tail = NULL;
+  obj_3* unreachable;
+  obj_3** wide;
+  int wasError = 0;
+  int i, j;
+
+  mem_reset_brk();
+  mm_init();
+
+  for (i = 0; i < CHAIN_LENGTH; i++) {
+    obj_3* link = mm_malloc(sizeof(obj_3));
+    link->ptr1 = NULL;
+    if (chain_tail == NULL) {
+      chain_head = link;
+    } else {
+      chain_tail->ptr1 = link;
+    }
+    chain_tail = link;
+  }
+  unreachable = mm_malloc(sizeof(obj_3));
+  unreachable->ptr1 = chain_head;
+
+  roots[0] = (void*) chain_head;
+  mm_garbage_collect(roots, 1);
+  mm_finish_sweep();
+
+  if (is_free(chain_head) || is_free(chain_tail)) {
+    printf("ERROR: A block at the end of a long chain was freed!\n");
+    wasError = 1;
+  }
+  if (!is_free(unreachable)) {
+    printf("ERROR: A block that was not reachable was not freed\n");
+    wasError = 1;
+  }
+
+  mem_reset_brk();
+  mm_init();
+
+  wide = mm_malloc(FAN_OUT * sizeof(obj_3*));
+  for (i = 0; i < FAN_OUT; i++) {
+    wide[i] = mm_malloc(sizeof(obj_3));
+    wide[i]->ptr1 = NULL;
+  }
+  // One leaf past the mark stack's capacity leads on to one more block,
+  // only found once the leaves that did not fit on it are recovered.
+  wide[FAN_OUT - 100]->ptr1 = mm_malloc(sizeof(obj_3));
+  ((obj_3*) wide[FAN_OUT - 100]->ptr1)->ptr1 = NULL;
+
+  roots[0] = (void*) wide;
+  mm_garbage_collect(roots, 1);
+  mm_finish_sweep();
+
+  for (i = 0; i < FAN_OUT; i++) {
+    if (is_free(wide[i])) {
+      printf("ERROR: A block that was reachable was freed!\n");
+      wasError = 1;
+      break;
+    }
+  }
+  if (is_free(wide[FAN_OUT - 100]->ptr1)) {
+    printf("ERROR: A block that was reachable was freed!\n");
+    wasError = 1;
+  }
+
+  // The same overflow during an incremental collection, where the heap is
+  // rescanned a step at a time. Between steps the mutator drops and frees
+  // leaves from the top of the heap down, until the frees meet the rescan
+  // coming up and free the block under it.
+  mem_reset_brk();
+  mm_init();
+
+  wide = mm_malloc(FAN_OUT * sizeof(obj_3*));
+  for (i = 0; i < FAN_OUT; i++) {
+    wide[i] = mm_malloc(sizeof(obj_3));
+    wide[i]->ptr1 = NULL;
+  }
+  wide[FAN_OUT - 100]->ptr1 = mm_malloc(sizeof(obj_3));
+  ((obj_3*) wide[FAN_OUT - 100]->ptr1)->ptr1 = NULL;
+
+  roots[0] = (void*) wide;
+  mm_gc_start(roots, 1);
+  for (i = FAN_OUT - 1; !mm_gc_step(mem_pagesize()); ) {
+    for (j = 0; j < FREES_PER_STEP && i >= 0; j++, i--) {
+      if (i != FAN_OUT - 100) {
+        obj_3* leaf = wide[i];
+        mm_write_barrier((void**) &wide[i], NULL);
+        mm_free(leaf);
+      }
+    }
+  }
+  mm_finish_sweep();
+
+  for (i = 0; i < FAN_OUT; i++) {
+    if (wide[i] != NULL && is_free(wide[i])) {
+      printf("ERROR: A block that was reachable was freed!\n");
+      wasError = 1;
+      break;
+    }
+  }
+  if (is_free(wide[FAN_OUT - 100]->ptr1)) {
+    printf("ERROR: A block that was reachable was freed!\n");
+    wasError = 1;
+  }
+
+  if (!wasError) {
+    printf("Success! Deep marking passed all of the tests\n");
+  }
+}
+
+static size_t block_size(void* payloadPtr) {
+  return *((size_t*) (((char*) payloadPtr) - WORD_SIZE)) & ~(size_t) 7;
+}
+
+static int in_heap(void* ptr) {
+  return ptr >= mem_heap_lo() && ptr <= mem_heap_hi();
+}
+
 static int is_free(void* payloadPtr) {
   size_t sizeAndTags = *((size_t*) (((char*) payloadPtr) - WORD_SIZE));
   return !(sizeAndTags & TAG_USED);
@@ -50,7 +50,7 @@ void mem_reset_brk() {
 /*
  * mem_sbrk - simple model of the sbrk function. Extends the heap
  *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    this model, the heap can only be shrunk with mem_trim.
  */
 void* mem_sbrk(size_t incr) {
   char* old_brk = mem_brk;
@@ -64,6 +64,21 @@ void* mem_sbrk(size_t incr) {
   return (void*) old_brk;
 }
 
+/*
+ * mem_trim - shrink the heap by decr bytes, giving back the end of the
+ *    area last handed out by mem_sbrk. Returns -1 if the heap is smaller
+ *    than decr.
+ */
+int mem_trim(size_t decr) {
+  if (decr > (size_t) (mem_brk - mem_start_brk)) {
+    errno = EINVAL;
+    fprintf(stderr, "ERROR: mem_trim failed. Heap is too small...\n");
+    return -1;
+  }
+  mem_brk -= decr;
+  return 0;
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
@@ -10,7 +10,21 @@
  *    start on this until you finish mm.c.
  *  - This file does not need to be submitted if you did not attempt it.
  */
+
+// The allocator in mm.c is wrapped rather than edited: its entry points are
+// renamed while it is included, and the versions defined at the bottom of
+// this file do the collector's bookkeeping around them.
+#define mm_init mm_heap_init
+#define mm_malloc mm_heap_malloc
+#define mm_free mm_heap_free
 #include "mm.c"
+#undef mm_init
+#undef mm_malloc
+#undef mm_free
+
+#include <string.h>
+#include "config.h"
+#include "mm.h"  // again, for the wrapped names
 
 
 // The tag to indicate that a block is marked.
@@ -18,8 +32,104 @@
 
 // Forward function declarations
 static void sweep(void);
+static size_t sweep_step(size_t budget);
 static int is_pointer(void* ptr);
 static void mark(void* ptr);
+static void shade(void* ptr);
+static void mark_step(size_t budget);
+static size_t rescan_step(size_t budget);
+static void set_block_start(void* ptr, int allocated);
+static int is_nursery_pointer(void* ptr);
+static void* evacuate(void* ptr);
+
+
+// Lazy sweeping: mm_garbage_collect() only marks, then points sweep_cursor at
+// the first block of the heap. Each later mm_malloc sweeps about a page of
+// heap from the cursor onwards (more if it needs the space), so the pause for
+// a collection is the mark phase alone. NULL means no sweep is pending.
+//
+// While a sweep is pending, sweep_cursor always points at the header of a
+// used block: free blocks are skipped when the cursor advances, and a block
+// that is freed while under the cursor moves the cursor past it first. That
+// keeps the cursor valid however the blocks around it are coalesced or split.
+static size_t* sweep_cursor = NULL;
+
+// A growable stack of payload pointers. Its storage comes from the C
+// library's heap, outside of the heap being collected.
+typedef struct ptr_stack {
+  void** items;
+  size_t top;
+  size_t capacity;
+} ptr_stack;
+
+// Marking (tri-color): a block is white while TAG_MARKED is unset, gray once
+// it is marked but still on gray_stack waiting to be scanned, and black once
+// it has been popped and scanned. marking is set while an incremental
+// collection is in progress.
+//
+// The gray stack stops growing at MARK_STACK_MAX entries. A block shaded
+// while it is full is marked but not pushed, and mark_stack_overflowed is
+// set; once the stack drains, the heap is rescanned for marked blocks that
+// may point to white ones. The rescan is marking work like any other and
+// resumes from rescan_cursor in each mark_step; like sweep_cursor, it points
+// at the header of a used block, and is NULL when no rescan is in progress.
+#define MARK_STACK_MAX (1 << 16)
+static int marking = 0;
+static ptr_stack gray_stack;
+static int mark_stack_overflowed = 0;
+static size_t* rescan_cursor = NULL;
+
+// Pointers found while scanning a block wait in prefetch_ring for
+// PREFETCH_DISTANCE more pointers before being shaded, so the prefetch of
+// their headers has time to complete before the mark bit is tested.
+#define PREFETCH_DISTANCE 8
+static void* prefetch_ring[PREFETCH_DISTANCE];
+static size_t prefetch_head = 0;
+static size_t prefetch_count = 0;
+
+// One bit per heap word, set for the first payload word of every allocated
+// block. Kept up to date by mm_malloc and mm_free, it makes is_pointer() a
+// bit test instead of a walk of the heap.
+static unsigned char block_starts[MAX_HEAP / WORD_SIZE / 8];
+
+// Roots of the incremental collection in progress, rescanned before it ends.
+static void** gc_roots = NULL;
+static int gc_num_roots = 0;
+
+// Generational nursery: mm_malloc_young() bump-allocates blocks out of a
+// fixed region outside of the heap. A nursery block is a header word holding
+// its size (tagged NURSERY_FORWARDED once it has been promoted, in which case
+// the first payload word holds its new address) followed by its payload.
+// nursery_starts records which words begin a payload, so that pointers into
+// the nursery can be recognized without walking it.
+#define NURSERY_SIZE (64 * 1024)
+#define NURSERY_WORDS (NURSERY_SIZE / WORD_SIZE)
+#define NURSERY_FORWARDED 1
+static size_t nursery[NURSERY_SIZE / sizeof(size_t)];
+static unsigned char nursery_starts[NURSERY_SIZE / sizeof(size_t)];
+static size_t nursery_top = 0;
+
+// Card table for the heap: mm_write_barrier() dirties the card holding any
+// slot that a nursery pointer is stored into, and minor collections scan
+// only the dirty cards for pointers into the nursery.
+#define CARD_SIZE 512
+static unsigned char card_table[MAX_HEAP / CARD_SIZE];
+
+// Blocks promoted by the minor collection in progress, still to be scanned.
+static ptr_stack promoted_stack;
+
+// Object layouts for precise collection. mm_malloc_layout() stores the
+// layout id in the last word of the block (used blocks have no footer, so
+// that word is otherwise unused), which tells mm_compact_collect() where the
+// pointer fields of the block are.
+#define MAX_LAYOUTS 64
+typedef struct gc_layout {
+  size_t size;
+  size_t* ptr_offsets;
+  int num_ptrs;
+} gc_layout;
+static gc_layout layouts[MAX_LAYOUTS];
+static int num_layouts = 0;
 
 
 /* A modified version of examine_heap() to include TAG_MARKED. */
@@ -54,25 +164,30 @@ static void examine_heap_gc() {
 }
 
 
+/* Set (allocated is 1) or clear the block_starts bit for the payload at ptr. */
+static void set_block_start(void* ptr, int allocated) {
+  size_t word = ((char*) ptr - (char*) mem_heap_lo()) / WORD_SIZE;
+
+  if (allocated) {
+    block_starts[word / 8] |= 1 << (word % 8);
+  } else {
+    block_starts[word / 8] &= ~(1 << (word % 8));
+  }
+}
+
+
 /*
  * This will determine if the given pointer points to the beginning
  * of the payload of a block which is allocated.
  */
 static int is_pointer(void* ptr) {
-  size_t* cur_block = (size_t*) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE);
-  size_t* heap_footer = (size_t*) UNSCALED_POINTER_SUB(mem_heap_hi(), WORD_SIZE - 1);
-
-  while (cur_block < heap_footer) {
-    size_t size_and_tags = *cur_block;
-    void* payload_ptr = UNSCALED_POINTER_ADD(cur_block, WORD_SIZE);
-    size_t allocated = size_and_tags & TAG_USED;
+  size_t word;
 
-    if (payload_ptr == ptr && allocated) {
-      return 1;
-    }
-    cur_block = (size_t*) UNSCALED_POINTER_ADD(cur_block, SIZE(size_and_tags));
+  if (ptr < mem_heap_lo() || ptr > mem_heap_hi() || (size_t) ptr % WORD_SIZE != 0) {
+    return 0;
   }
-  return 0;
+  word = ((char*) ptr - (char*) mem_heap_lo()) / WORD_SIZE;
+  return (block_starts[word / 8] >> (word % 8)) & 1;
 }
 
 
@@ -81,32 +196,752 @@ static int is_pointer(void* ptr) {
  * beginning of the payload of the block. Use the tag TAG_MARKED to signify
  * that a block is reachable. Next go and mark all other blocks that are
  * pointed to by pointers in this block.
+ *
+ * The blocks still to be scanned are kept on the explicit gray stack rather
+ * than the C stack, so arbitrarily deep structures (like a long linked list)
+ * can be marked.
  */
 static void mark(void* ptr) {
-  size_t* block_header = (size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+  shade(ptr);
+  mark_step((size_t) -1);
+}
+
+
+/*
+ * Return the first used block at or after block, or NULL if there is none
+ * before the heap footer.
+ */
+static size_t* skip_free_blocks(size_t* block) {
+  while ((*block & TAG_USED) == 0) {
+    block = (size_t*) UNSCALED_POINTER_ADD(block, SIZE(*block));
+  }
+  return SIZE(*block) == 0 ? NULL : block;
+}
+
+
+/*
+ * Sweep from sweep_cursor until at least budget bytes of heap have been
+ * examined, freeing the unmarked blocks and unmarking the rest. Reaching the
+ * heap footer ends the sweep. Returns the size of the largest free block
+ * left by the blocks it freed, once coalesced, or 0 if it freed none.
+ */
+static size_t sweep_step(size_t budget) {
+  size_t* cur_block = sweep_cursor;
+  size_t* heap_footer = (size_t*) UNSCALED_POINTER_SUB(mem_heap_hi(), WORD_SIZE - 1);
+  size_t swept = 0;
+  size_t largest = 0;
+
+  while (cur_block != NULL && swept < budget) {
+    size_t size_and_tags = *cur_block;
+
+    // Find the next used block before freeing this one, since freeing
+    // coalesces it with the free blocks around it.
+    size_t* next_block = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(cur_block, SIZE(size_and_tags)));
+    if (size_and_tags & TAG_MARKED) {
+      *cur_block = size_and_tags & ~TAG_MARKED;
+    } else {
+      // The coalesced free block now runs up to the next used block, so
+      // its boundary tag is the word before that.
+      size_t* free_end = next_block != NULL ? next_block : heap_footer;
+      size_t free_size;
 
-  // TODO: Implement mark.
+      set_block_start(UNSCALED_POINTER_ADD(cur_block, WORD_SIZE), 0);
+      mm_heap_free(UNSCALED_POINTER_ADD(cur_block, WORD_SIZE));
+      free_size = SIZE(*(free_end - 1));
+      if (free_size > largest) {
+        largest = free_size;
+      }
+    }
+    swept += SIZE(size_and_tags);
+    cur_block = next_block;
+  }
+  sweep_cursor = cur_block;
+  return largest;
 }
 
 
 /*
- * Sweep through the all of the allocated blocks in the heap and free all
+ * Sweep through the rest of the allocated blocks in the heap and free all
  * that are unreachable (i.e., TAG_MARKED is unset).
  */
 static void sweep() {
-  size_t* cur_block = (size_t*) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE);
-  size_t* heap_footer = (size_t*) UNSCALED_POINTER_SUB(mem_heap_hi(), WORD_SIZE - 1);
+  sweep_step((size_t) -1);
+}
 
-  // TODO: Implement sweep.
+
+/*
+ * Finish any sweep left pending by mm_garbage_collect(). Callers that need
+ * every unreachable block freed right away can call this after collecting.
+ */
+void mm_finish_sweep() {
+  sweep();
 }
 
 
-/* Run the mark-and-sweep garbage collection algorithm. */
+/*
+ * Run the mark-and-sweep garbage collection algorithm. Only the mark phase
+ * happens here; the sweep is spread over the following mm_malloc calls.
+ */
 void mm_garbage_collect(void* rootPtrs[], int num_roots) {
   int i;
+
+  // Finish any incremental collection, then clear the mark bits left from
+  // the previous collection by sweeping. Marking does not look inside the
+  // nursery, so empty it too.
+  while (!mm_gc_step((size_t) -1)) {
+  }
+  mm_finish_sweep();
+  mm_minor_collect(rootPtrs, num_roots);
+
   for (i = 0; i < num_roots; i++) {
     void* root = rootPtrs[i];
     mark(root);
   }
-  sweep();
+
+  sweep_cursor = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE));
+}
+
+
+// INCREMENTAL MARKING ----------------------------------------------
+
+/* Push ptr onto stack, growing it as needed. */
+static void push_ptr(ptr_stack* stack, void* ptr) {
+  if (stack->top == stack->capacity) {
+    stack->capacity = stack->capacity ? 2 * stack->capacity : mem_pagesize() / WORD_SIZE;
+    stack->items = realloc(stack->items, stack->capacity * sizeof(void*));
+    if (stack->items == NULL) {
+      printf("ERROR: could not grow a collector stack\n");
+      exit(1);
+    }
+  }
+  stack->items[stack->top++] = ptr;
+}
+
+
+/* Make the block pointed to by ptr gray if it is an unmarked (white) block. */
+static void shade(void* ptr) {
+  size_t* block_header = (size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+
+  if (!is_pointer(ptr) || (*block_header & TAG_MARKED)) {
+    return;
+  }
+  *block_header |= TAG_MARKED;
+
+  if (gray_stack.top == MARK_STACK_MAX) {
+    mark_stack_overflowed = 1;
+    return;
+  }
+  push_ptr(&gray_stack, ptr);
+}
+
+
+/*
+ * Shade ptr, a pointer to an allocated block, once PREFETCH_DISTANCE more
+ * pointers have come through here. Its header is prefetched now.
+ */
+static void shade_later(void* ptr) {
+  __builtin_prefetch(UNSCALED_POINTER_SUB(ptr, WORD_SIZE), 1);
+
+  if (prefetch_count == PREFETCH_DISTANCE) {
+    shade(prefetch_ring[prefetch_head]);
+    prefetch_ring[prefetch_head] = ptr;
+    prefetch_head = (prefetch_head + 1) % PREFETCH_DISTANCE;
+  } else {
+    prefetch_ring[(prefetch_head + prefetch_count) % PREFETCH_DISTANCE] = ptr;
+    prefetch_count++;
+  }
+}
+
+
+/* Shade every pointer still waiting in the prefetch ring. */
+static void flush_prefetch_ring() {
+  while (prefetch_count > 0) {
+    shade(prefetch_ring[prefetch_head]);
+    prefetch_head = (prefetch_head + 1) % PREFETCH_DISTANCE;
+    prefetch_count--;
+  }
+}
+
+
+/*
+ * Recover from a gray stack overflow: shade everything that marked blocks
+ * point to, pushing the white blocks that were missed back on the stack.
+ * Starts a pass over the heap if none is in progress, and stops after about
+ * budget bytes of heap, or as soon as a block lands on the gray stack, so
+ * the stack is drained before the pass goes on. Returns the bytes examined.
+ */
+static size_t rescan_step(size_t budget) {
+  size_t examined = 0;
+
+  if (rescan_cursor == NULL) {
+    mark_stack_overflowed = 0;
+    rescan_cursor = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE));
+  }
+  while (rescan_cursor != NULL && examined < budget && gray_stack.top == 0) {
+    void** payload = (void**) UNSCALED_POINTER_ADD(rescan_cursor, WORD_SIZE);
+    size_t num_words = (SIZE(*rescan_cursor) - WORD_SIZE) / WORD_SIZE;
+    size_t i;
+
+    if (*rescan_cursor & TAG_MARKED) {
+      for (i = 0; i < num_words; i++) {
+        shade(payload[i]);
+      }
+    }
+    examined += SIZE(*rescan_cursor);
+    rescan_cursor = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(rescan_cursor, SIZE(*rescan_cursor)));
+  }
+  return examined;
+}
+
+
+/* Returns whether any marking work is left (gray blocks, pending shades or
+   a rescan). */
+static int mark_work_left() {
+  return gray_stack.top > 0 || prefetch_count > 0 || mark_stack_overflowed ||
+         rescan_cursor != NULL;
+}
+
+
+/*
+ * Scan gray blocks, and the heap once they run out after an overflow, until
+ * about budget bytes have been scanned or no work is left, shading
+ * everything they point to.
+ */
+static void mark_step(size_t budget) {
+  size_t scanned = 0;
+
+  while (scanned < budget) {
+    void** payload;
+    size_t* block_header;
+    size_t num_words;
+    size_t i;
+
+    if (gray_stack.top == 0) {
+      if (prefetch_count > 0) {
+        flush_prefetch_ring();
+      } else if (mark_stack_overflowed || rescan_cursor != NULL) {
+        scanned += rescan_step(budget - scanned);
+      } else {
+        break;
+      }
+      continue;
+    }
+
+    payload = gray_stack.items[--gray_stack.top];
+    block_header = (size_t*) UNSCALED_POINTER_SUB(payload, WORD_SIZE);
+
+    // The mutator may have freed a gray block since it was shaded.
+    if (!is_pointer(payload)) {
+      continue;
+    }
+
+    // Conservatively treat every word of the payload as a possible pointer.
+    num_words = (SIZE(*block_header) - WORD_SIZE) / WORD_SIZE;
+    for (i = 0; i < num_words; i++) {
+      if (is_pointer(payload[i])) {
+        shade_later(payload[i]);
+      }
+    }
+    scanned += num_words * WORD_SIZE;
+  }
+}
+
+
+/*
+ * Begin an incremental collection from the given roots. Marking then
+ * proceeds through calls to mm_gc_step(). The rootPtrs array must stay valid
+ * until the collection ends, as it is scanned again before marking finishes.
+ */
+void mm_gc_start(void* rootPtrs[], int num_roots) {
+  int i;
+
+  // Finish the previous collection, including its sweep, and empty the
+  // nursery: marking does not look inside it.
+  while (!mm_gc_step((size_t) -1)) {
+  }
+  mm_finish_sweep();
+  mm_minor_collect(rootPtrs, num_roots);
+
+  gc_roots = rootPtrs;
+  gc_num_roots = num_roots;
+  marking = 1;
+  for (i = 0; i < num_roots; i++) {
+    shade(rootPtrs[i]);
+  }
+}
+
+
+/*
+ * Do about budget bytes of marking work for the collection in progress.
+ * Returns 1 once marking has finished (the heap is then swept lazily, as
+ * after mm_garbage_collect()) or if no collection is in progress.
+ */
+int mm_gc_step(size_t budget) {
+  int i;
+
+  if (!marking) {
+    return 1;
+  }
+
+  mark_step(budget);
+  if (mark_work_left()) {
+    return 0;
+  }
+
+  // Stores into the roots do not go through the write barrier, so rescan
+  // them. Marking is only done once that turns up nothing new.
+  for (i = 0; i < gc_num_roots; i++) {
+    shade(gc_roots[i]);
+  }
+  if (mark_work_left()) {
+    return 0;
+  }
+
+  marking = 0;
+  gc_roots = NULL;
+  gc_num_roots = 0;
+  sweep_cursor = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE));
+  return 1;
+}
+
+
+/*
+ * Store value into the pointer field at slot. Every store of a pointer into
+ * a block must go through here while an incremental collection is marking
+ * or when the pointer is into the nursery:
+ *  - Shading the new target while marking (a Dijkstra-style insertion
+ *    barrier) keeps a black block from ever pointing at a white one.
+ *  - Storing a nursery pointer into the heap dirties the slot's card so the
+ *    next minor collection finds it.
+ */
+void mm_write_barrier(void** slot, void* value) {
+  if (marking) {
+    shade(value);
+  }
+  if (is_nursery_pointer(value) &&
+      (void*) slot >= mem_heap_lo() && (void*) slot <= mem_heap_hi()) {
+    card_table[((char*) slot - (char*) mem_heap_lo()) / CARD_SIZE] = 1;
+  }
+  *slot = value;
+}
+
+
+// GENERATIONAL NURSERY ---------------------------------------------
+
+/* Returns whether ptr points to the payload of a block in the nursery. */
+static int is_nursery_pointer(void* ptr) {
+  size_t* word = (size_t*) ptr;
+
+  if (word < nursery + 1 || word >= nursery + NURSERY_WORDS ||
+      (size_t) ptr % WORD_SIZE != 0) {
+    return 0;
+  }
+  return nursery_starts[word - nursery];
+}
+
+
+/*
+ * Promote the nursery block pointed to by ptr into the heap (once) and
+ * return its new address. Any other pointer is returned unchanged.
+ */
+static void* evacuate(void* ptr) {
+  size_t* header;
+  size_t payload_size;
+  void* new_ptr;
+
+  if (!is_nursery_pointer(ptr)) {
+    return ptr;
+  }
+
+  header = (size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+  if (*header & NURSERY_FORWARDED) {
+    return *((void**) ptr);
+  }
+
+  payload_size = SIZE(*header) - WORD_SIZE;
+  new_ptr = mm_malloc(payload_size);
+  memcpy(new_ptr, ptr, payload_size);
+  *header |= NURSERY_FORWARDED;
+  *((void**) ptr) = new_ptr;
+  push_ptr(&promoted_stack, new_ptr);
+  return new_ptr;
+}
+
+
+/*
+ * Allocate a block of size bytes in the nursery. Nursery blocks are only
+ * reclaimed (or promoted into the heap) by mm_minor_collect(); mm_free
+ * ignores them. Once the nursery is full, blocks come from the heap instead
+ * until the next minor collection empties it.
+ */
+void* mm_malloc_young(size_t size) {
+  size_t num_words = (size + WORD_SIZE - 1) / WORD_SIZE + 1;
+  size_t* block;
+
+  if (size == 0) {
+    return NULL;
+  }
+  if (num_words > NURSERY_WORDS - nursery_top) {
+    return mm_malloc(size);
+  }
+
+  block = nursery + nursery_top;
+  nursery_top += num_words;
+  *block = num_words * WORD_SIZE;
+  nursery_starts[block + 1 - nursery] = 1;
+  return block + 1;
+}
+
+
+/*
+ * Run a minor collection: promote every nursery block reachable from the
+ * roots or from the dirty cards of the heap, updating the pointers to them
+ * (including the entries of rootPtrs), then empty the nursery. Returns the
+ * number of blocks promoted.
+ *
+ * As with marking, every word of a block is treated as a possible pointer,
+ * so a non-pointer that happens to hold the address of a nursery payload is
+ * rewritten along with the real pointers.
+ */
+int mm_minor_collect(void* rootPtrs[], int num_roots) {
+  void** first_word = (void**) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE);
+  void** heap_footer = (void**) UNSCALED_POINTER_SUB(mem_heap_hi(), WORD_SIZE - 1);
+  size_t num_cards = (mem_heapsize() + CARD_SIZE - 1) / CARD_SIZE;
+  size_t card;
+  int num_promoted = 0;
+  int i;
+
+  for (i = 0; i < num_roots; i++) {
+    rootPtrs[i] = evacuate(rootPtrs[i]);
+  }
+
+  for (card = 0; card < num_cards; card++) {
+    void** word;
+    void** card_end;
+
+    if (!card_table[card]) {
+      continue;
+    }
+    card_table[card] = 0;
+
+    word = (void**) UNSCALED_POINTER_ADD(mem_heap_lo(), card * CARD_SIZE);
+    card_end = word + CARD_SIZE / WORD_SIZE;
+    if (word < first_word) {
+      word = first_word;
+    }
+    if (card_end > heap_footer) {
+      card_end = heap_footer;
+    }
+    for (; word < card_end; word++) {
+      if (is_nursery_pointer(*word)) {
+        *word = evacuate(*word);
+      }
+    }
+  }
+
+  // Promoted blocks may point to more of the nursery.
+  while (promoted_stack.top > 0) {
+    void** payload = promoted_stack.items[--promoted_stack.top];
+    size_t* block_header = (size_t*) UNSCALED_POINTER_SUB(payload, WORD_SIZE);
+    size_t num_words = (SIZE(*block_header) - WORD_SIZE) / WORD_SIZE;
+    size_t j;
+
+    for (j = 0; j < num_words; j++) {
+      if (is_nursery_pointer(payload[j])) {
+        payload[j] = evacuate(payload[j]);
+      }
+    }
+    num_promoted++;
+  }
+
+  memset(nursery_starts, 0, nursery_top);
+  nursery_top = 0;
+  return num_promoted;
+}
+
+
+// PRECISE MARK-COMPACT ---------------------------------------------
+
+/*
+ * Register the layout of a type of block: its size and the byte offsets of
+ * its pointer fields. Returns the id to pass to mm_malloc_layout(), or -1 if
+ * there are too many layouts.
+ */
+int mm_register_layout(size_t size, const size_t ptr_offsets[], int num_ptrs) {
+  gc_layout* layout;
+
+  if (num_layouts == MAX_LAYOUTS) {
+    return -1;
+  }
+  layout = &layouts[num_layouts];
+  layout->size = size;
+  layout->num_ptrs = num_ptrs;
+  layout->ptr_offsets = malloc(num_ptrs * sizeof(size_t));
+  if (num_ptrs > 0 && layout->ptr_offsets == NULL) {
+    return -1;
+  }
+  memcpy(layout->ptr_offsets, ptr_offsets, num_ptrs * sizeof(size_t));
+  return num_layouts++;
+}
+
+
+/* Returns the layout of a block allocated by mm_malloc_layout(). */
+static gc_layout* block_layout(size_t* block_header) {
+  size_t* last_word = (size_t*) UNSCALED_POINTER_ADD(block_header, SIZE(*block_header) - WORD_SIZE);
+  return &layouts[*last_word];
+}
+
+
+/* Allocate a block with the given registered layout. */
+void* mm_malloc_layout(int layout_id) {
+  void* ptr = mm_malloc(layouts[layout_id].size + WORD_SIZE);
+  size_t* block_header = (size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+
+  *((size_t*) UNSCALED_POINTER_ADD(block_header, SIZE(*block_header) - WORD_SIZE)) = layout_id;
+  return ptr;
+}
+
+
+/* Mark the block at ptr (a precise pointer) and push it to be scanned. */
+static void mark_precise(void* ptr) {
+  size_t* block_header = (size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+
+  if (ptr == NULL || (*block_header & TAG_MARKED)) {
+    return;
+  }
+  *block_header |= TAG_MARKED;
+  push_ptr(&gray_stack, ptr);
+}
+
+
+/*
+ * Return the new address of the live block at ptr, looked up in the
+ * forwarding table (old_addrs is sorted, as it is built in heap order).
+ */
+static void* forward(void* ptr, void** old_addrs, void** new_addrs, size_t num_live) {
+  size_t lo = 0;
+  size_t hi = num_live;
+
+  if (ptr == NULL) {
+    return NULL;
+  }
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (old_addrs[mid] < ptr) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return new_addrs[lo];
+}
+
+
+/*
+ * Run a sliding mark-compact collection. Every root is the address of a
+ * pointer variable (updated to the new address of its block), and every
+ * block reachable from them must come from mm_malloc_layout(), with each of
+ * its pointer fields NULL or pointing to such a block. The nursery must be
+ * empty.
+ *
+ * Live blocks are slid down to the bottom of the heap in address order, so
+ * all the free space ends up in one block at the top, of which all but a page
+ * is given back with mem_trim(). With a single free block, first-fit
+ * allocation then just carves blocks off the front of it, like a bump
+ * pointer. Returns the number of bytes trimmed, or -1 if the nursery is not
+ * empty.
+ */
+int mm_compact_collect(void** rootSlots[], int num_roots) {
+  size_t* first_block = (size_t*) UNSCALED_POINTER_ADD(mem_heap_lo(), WORD_SIZE);
+  size_t* heap_footer = (size_t*) UNSCALED_POINTER_SUB(mem_heap_hi(), WORD_SIZE - 1);
+  size_t* cur_block;
+  size_t* new_top;
+  void** old_addrs;
+  void** new_addrs;
+  size_t num_live = 0;
+  size_t live_capacity = 0;
+  size_t remaining;
+  size_t keep;
+  size_t k;
+  int i;
+
+  if (nursery_top != 0) {
+    return -1;
+  }
+
+  // Finish any other collection first, which also clears all mark bits.
+  while (!mm_gc_step((size_t) -1)) {
+  }
+  mm_finish_sweep();
+
+  // Mark, following only the pointer fields of each layout.
+  for (i = 0; i < num_roots; i++) {
+    mark_precise(*rootSlots[i]);
+  }
+  while (gray_stack.top > 0) {
+    void* payload = gray_stack.items[--gray_stack.top];
+    gc_layout* layout = block_layout((size_t*) UNSCALED_POINTER_SUB(payload, WORD_SIZE));
+    for (i = 0; i < layout->num_ptrs; i++) {
+      mark_precise(*((void**) UNSCALED_POINTER_ADD(payload, layout->ptr_offsets[i])));
+    }
+  }
+
+  // Compute forwarding addresses: live blocks are packed from the bottom of
+  // the heap in address order.
+  old_addrs = NULL;
+  new_addrs = NULL;
+  new_top = first_block;
+  for (cur_block = first_block; cur_block < heap_footer;
+       cur_block = (size_t*) UNSCALED_POINTER_ADD(cur_block, SIZE(*cur_block))) {
+    if ((*cur_block & (TAG_USED | TAG_MARKED)) != (TAG_USED | TAG_MARKED)) {
+      continue;
+    }
+    if (num_live == live_capacity) {
+      live_capacity = live_capacity ? 2 * live_capacity : mem_pagesize() / WORD_SIZE;
+      old_addrs = realloc(old_addrs, live_capacity * sizeof(void*));
+      new_addrs = realloc(new_addrs, live_capacity * sizeof(void*));
+      if (old_addrs == NULL || new_addrs == NULL) {
+        printf("ERROR: could not grow the forwarding table\n");
+        exit(1);
+      }
+    }
+    old_addrs[num_live] = UNSCALED_POINTER_ADD(cur_block, WORD_SIZE);
+    new_addrs[num_live] = UNSCALED_POINTER_ADD(new_top, WORD_SIZE);
+    num_live++;
+    new_top = (size_t*) UNSCALED_POINTER_ADD(new_top, SIZE(*cur_block));
+  }
+
+  // Update the roots and every pointer field of the live blocks, still at
+  // their old addresses.
+  for (i = 0; i < num_roots; i++) {
+    *rootSlots[i] = forward(*rootSlots[i], old_addrs, new_addrs, num_live);
+  }
+  for (k = 0; k < num_live; k++) {
+    gc_layout* layout = block_layout((size_t*) UNSCALED_POINTER_SUB(old_addrs[k], WORD_SIZE));
+    for (i = 0; i < layout->num_ptrs; i++) {
+      void** field = (void**) UNSCALED_POINTER_ADD(old_addrs[k], layout->ptr_offsets[i]);
+      *field = forward(*field, old_addrs, new_addrs, num_live);
+    }
+  }
+
+  // Slide the blocks down. Each one now follows a used block.
+  memset(block_starts, 0, (mem_heapsize() / WORD_SIZE + 7) / 8);
+  for (k = 0; k < num_live; k++) {
+    size_t* old_block = (size_t*) UNSCALED_POINTER_SUB(old_addrs[k], WORD_SIZE);
+    size_t* new_block = (size_t*) UNSCALED_POINTER_SUB(new_addrs[k], WORD_SIZE);
+    size_t size = SIZE(*old_block);
+    memmove(new_block, old_block, size);
+    *new_block = size | TAG_PRECEDING_USED | TAG_USED;
+    set_block_start(new_addrs[k], 1);
+  }
+  free(old_addrs);
+  free(new_addrs);
+
+  // Everything above the live blocks is free. Keep up to a page of it as the
+  // one free block and trim the rest.
+  remaining = (char*) heap_footer - (char*) new_top;
+  keep = remaining < mem_pagesize() ? remaining : mem_pagesize();
+  mem_trim(remaining - keep);
+
+  FREE_LIST_HEAD = NULL;
+  if (keep > 0) {
+    block_info* free_block = (block_info*) new_top;
+    free_block->size_and_tags = keep | TAG_PRECEDING_USED;
+    *((size_t*) UNSCALED_POINTER_ADD(free_block, keep - WORD_SIZE)) = keep | TAG_PRECEDING_USED;
+    insert_free_block(free_block);
+    *((size_t*) UNSCALED_POINTER_ADD(new_top, keep)) = TAG_USED;
+  } else {
+    *new_top = TAG_PRECEDING_USED | TAG_USED;
+  }
+
+  // Old card marks refer to addresses that have moved.
+  memset(card_table, 0, sizeof(card_table));
+  return (int) (remaining - keep);
+}
+
+
+// ALLOCATOR INTERFACE ----------------------------------------------
+
+/* Initialize the allocator, dropping any collection in progress. */
+int mm_init() {
+  sweep_cursor = NULL;
+  marking = 0;
+  gray_stack.top = 0;
+  mark_stack_overflowed = 0;
+  rescan_cursor = NULL;
+  prefetch_count = 0;
+  memset(block_starts, 0, sizeof(block_starts));
+  gc_roots = NULL;
+  gc_num_roots = 0;
+  memset(nursery_starts, 0, sizeof(nursery_starts));
+  nursery_top = 0;
+  memset(card_table, 0, sizeof(card_table));
+  promoted_stack.top = 0;
+  return mm_heap_init();
+}
+
+
+/*
+ * Allocate a block, first sweeping a page of the heap if a sweep is pending.
+ * If that does not free up a fit and the free list holds none either, keep
+ * sweeping until a block big enough has been freed before growing the heap.
+ * Only the sizes sweep_step reports are checked while sweeping on, so the
+ * free list is searched once however many pages that takes.
+ */
+void* mm_malloc(size_t size) {
+  void* ptr;
+
+  if (sweep_cursor != NULL) {
+    // The block size mm_heap_malloc will look for
+    size_t req_size = ALIGNMENT * ((size + WORD_SIZE + ALIGNMENT - 1) / ALIGNMENT);
+    size_t largest;
+
+    if (req_size < MIN_BLOCK_SIZE) {
+      req_size = MIN_BLOCK_SIZE;
+    }
+    largest = sweep_step(mem_pagesize());
+    if (largest < req_size && search_free_list(req_size) == NULL) {
+      while (sweep_cursor != NULL && largest < req_size) {
+        size_t freed = sweep_step(mem_pagesize());
+        if (freed > largest) {
+          largest = freed;
+        }
+      }
+    }
+  }
+
+  ptr = mm_heap_malloc(size);
+  if (ptr != NULL) {
+    set_block_start(ptr, 1);
+  }
+
+  // New blocks are allocated black while marking. A block handed out ahead
+  // of the sweep cursor is live too; mark it so the rest of the sweep does
+  // not free it.
+  if (ptr != NULL && (marking || (sweep_cursor != NULL &&
+      UNSCALED_POINTER_SUB(ptr, WORD_SIZE) > (void*) sweep_cursor))) {
+    *((size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE)) |= TAG_MARKED;
+  }
+  return ptr;
+}
+
+
+/*
+ * Free a block, moving the sweep and rescan cursors off of it first if
+ * needed. Nursery blocks are left for the next minor collection.
+ */
+void mm_free(void* ptr) {
+  size_t* block = (size_t*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+
+  if (ptr == NULL || is_nursery_pointer(ptr)) {
+    return;
+  }
+  if (block == sweep_cursor) {
+    sweep_cursor = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(block, SIZE(*block)));
+  }
+  if (block == rescan_cursor) {
+    rescan_cursor = skip_free_blocks((size_t*) UNSCALED_POINTER_ADD(block, SIZE(*block)));
+  }
+  set_block_start(ptr, 0);
+  mm_heap_free(ptr);
 }
@@ -365,10 +365,35 @@ void* mm_malloc(size_t size) {
     req_size = ALIGNMENT * ((size + ALIGNMENT - 1) / ALIGNMENT);
   }
 
-  // TODO: Implement mm_malloc.  You can change or remove any of the
-  // above code.  It is included as a suggestion of where to start.
-  // You will want to replace this return statement...
-  return NULL;
+  // Find a fit, growing the heap if nothing on the free list is big enough.
+  ptr_free_block = search_free_list(req_size);
+  if (ptr_free_block == NULL) {
+    request_more_space(req_size);
+    ptr_free_block = search_free_list(req_size);
+  }
+
+  block_size = SIZE(ptr_free_block->size_and_tags);
+  preceding_block_use_tag = ptr_free_block->size_and_tags & TAG_PRECEDING_USED;
+  remove_free_block(ptr_free_block);
+
+  if (block_size - req_size >= MIN_BLOCK_SIZE) {
+    // Split: the remainder becomes a new free block following this one.
+    // The block after the remainder keeps TAG_PRECEDING_USED unset.
+    block_info* remainder = (block_info*) UNSCALED_POINTER_ADD(ptr_free_block, req_size);
+    size_t remainder_size = block_size - req_size;
+    remainder->size_and_tags = remainder_size | TAG_PRECEDING_USED;
+    *((size_t*) UNSCALED_POINTER_ADD(remainder, remainder_size - WORD_SIZE)) =
+        remainder_size | TAG_PRECEDING_USED;
+    insert_free_block(remainder);
+    block_size = req_size;
+  } else {
+    // Use the whole block, so the following block now has a used predecessor.
+    block_info* following_block = (block_info*) UNSCALED_POINTER_ADD(ptr_free_block, block_size);
+    following_block->size_and_tags |= TAG_PRECEDING_USED;
+  }
+
+  ptr_free_block->size_and_tags = block_size | preceding_block_use_tag | TAG_USED;
+  return UNSCALED_POINTER_ADD(ptr_free_block, WORD_SIZE);
 }
 
 
@@ -378,9 +403,31 @@ void mm_free(void* ptr) {
   block_info* block_to_free;
   block_info* following_block;
 
-  // TODO: Implement mm_free.  You can change or remove the declaraions
-  // above.  They are included as minor hints.
+  if (ptr == NULL) {
+    return;
+  }
+
+  block_to_free = (block_info*) UNSCALED_POINTER_SUB(ptr, WORD_SIZE);
+  payload_size = SIZE(block_to_free->size_and_tags);
+  following_block = (block_info*) UNSCALED_POINTER_ADD(block_to_free, payload_size);
+
+  // Rewrite the header without TAG_USED (or any other tags) and add a footer.
+  block_to_free->size_and_tags =
+      payload_size | (block_to_free->size_and_tags & TAG_PRECEDING_USED);
+  *((size_t*) UNSCALED_POINTER_ADD(block_to_free, payload_size - WORD_SIZE)) =
+      block_to_free->size_and_tags;
+
+  // The following block's predecessor is now free; keep its footer (if it
+  // has one) in sync with its header.
+  following_block->size_and_tags &= ~TAG_PRECEDING_USED;
+  if ((following_block->size_and_tags & TAG_USED) == 0) {
+    *((size_t*) UNSCALED_POINTER_ADD(following_block,
+                                     SIZE(following_block->size_and_tags) - WORD_SIZE)) =
+        following_block->size_and_tags;
+  }
 
+  insert_free_block(block_to_free);
+  coalesce_free_block(block_to_free);
 }
 
 
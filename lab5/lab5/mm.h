@@ -9,3 +9,12 @@ extern void* mm_realloc(void* ptr, size_t size);
 
 // Garbage collector extra credit
 extern void mm_garbage_collect(void* rootPtrs[], int numRoots);
+extern void mm_finish_sweep(void);
+extern void mm_gc_start(void* rootPtrs[], int numRoots);
+extern int mm_gc_step(size_t budget);
+extern void mm_write_barrier(void** slot, void* value);
+extern void* mm_malloc_young(size_t size);
+extern int mm_minor_collect(void* rootPtrs[], int numRoots);
+extern int mm_register_layout(size_t size, const size_t ptr_offsets[], int num_ptrs);
+extern void* mm_malloc_layout(int layout_id);
+extern int mm_compact_collect(void** rootSlots[], int numRoots);